@@ -3,27 +3,59 @@
 // Per-vertex attributes
 layout(location = 0) in vec2 inPosition;
 
-// Per-instance attributes
-layout(location = 1) in vec2 inOffset;
-layout(location = 2) in vec3 inColor;
-layout(location = 3) in float inScale;
+// Per-instance attributes, unpacked from InstanceData's normalized formats
+layout(location = 1) in vec2 inOffset;      // R16G16_SNORM, times POSITION_RANGE
+layout(location = 2) in vec4 inColor;       // R8G8B8A8_UNORM
+layout(location = 3) in float inScale;      // R16_UNORM, times SCALE_RANGE
+layout(location = 4) in vec2 inPrevOffset;  // R16G16_SNORM, times POSITION_RANGE
+layout(location = 5) in uint inType;        // R16_UINT, an InstanceType
+
+// Must match InstanceData::POSITION_RANGE and SCALE_RANGE
+const float POSITION_RANGE = 32.0;
+const float SCALE_RANGE = 4.0;
+
+// Must match InstanceType; enemies and boundary markers are coloured here
+const uint TYPE_ENEMY = 2u;
+const uint TYPE_BOUNDARY = 3u;
+
+// Enemies redden and grow as the hero gets within this distance
+const float DANGER_RADIUS = 8.0;
 
 // Output to fragment shader
 layout(location = 0) out vec3 fragColor;
 
-// Push constants for view transformation
+// Push constants for view transformation and enemy colouring
 layout(push_constant) uniform PushConstants {
     vec2 viewScale;    // Converts world coords to NDC
     vec2 viewOffset;   // Camera position
+    vec2 heroPosition; // Hero at the same interpolation as the instances
+    float interpolation; // 0 = previous tick, 1 = current tick
+    float time;        // Game time, for animating static instances
 } pc;
 
 void main() {
-    // Scale vertex, add instance offset (world position)
-    vec2 worldPos = inPosition * inScale + inOffset;
+    // Instance offset (world position) between the last two ticks
+    vec2 offset = mix(inPrevOffset, inOffset, pc.interpolation) * POSITION_RANGE;
+    
+    vec3 color = inColor.rgb;
+    float scale = inScale * SCALE_RANGE;
+    if (inType == TYPE_ENEMY) {
+        // More vibrant colors, danger indication
+        float proximity = 1.0 - clamp(distance(offset, pc.heroPosition) / DANGER_RADIUS, 0.0, 1.0);
+        color = vec3(0.8 + proximity * 0.2, 0.25 - proximity * 0.15, 0.05 + proximity * 0.1);
+        scale = 0.18 + proximity * 0.06;
+    } else if (inType == TYPE_BOUNDARY) {
+        // Pulsing boundary color
+        float pulse = sin(pc.time * 2.0) * 0.3 + 0.5;
+        color.g += pulse * 0.2;
+    }
+    
+    // Scale vertex and add the offset
+    vec2 worldPos = inPosition * scale + offset;
     
     // Transform to NDC using orthographic projection
     vec2 ndcPos = (worldPos - pc.viewOffset) * pc.viewScale;
     
     gl_Position = vec4(ndcPos, 0.0, 1.0);
-    fragColor = inColor;
+    fragColor = color;
 }
\ No newline at end of file
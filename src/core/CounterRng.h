@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+
+namespace Legionfall {
+
+// Stateless counter-based generator (Widynski's "Squares"). A draw depends
+// only on the key and the counter, never on earlier draws, so an entity's
+// numbers come out the same whichever thread draws them and in what order.
+class CounterRng {
+public:
+    // Streams with the same seed are independent of each other
+    CounterRng(uint64_t seed, uint64_t stream) : m_key(mix(seed ^ mix(stream + 1)) | 1) {}
+    
+    // Counter for the draw-th number of an entity in a given round (spawn
+    // generation, frame, ...). Rounds wrap after 2^28 and draws after 16.
+    static uint64_t counter(uint32_t entity, uint32_t round, uint32_t draw) {
+        return ((uint64_t)entity << 32) | ((uint64_t)(round & 0x0fffffffu) << 4) | (draw & 0xfu);
+    }
+    
+    uint32_t bits(uint64_t ctr) const {
+        uint64_t x = ctr * m_key;
+        uint64_t y = x;
+        uint64_t z = y + m_key;
+        x = x * x + y; x = (x >> 32) | (x << 32);
+        x = x * x + z; x = (x >> 32) | (x << 32);
+        x = x * x + y; x = (x >> 32) | (x << 32);
+        return (uint32_t)((x * x + z) >> 32);
+    }
+    
+    // Uniform in [lo, hi)
+    float uniform(uint64_t ctr, float lo, float hi) const {
+        return lo + (hi - lo) * ((float)(bits(ctr) >> 8) * (1.0f / 16777216.0f));
+    }
+    
+    // Uniform in [0, n)
+    uint32_t below(uint64_t ctr, uint32_t n) const {
+        return (uint32_t)(((uint64_t)bits(ctr) * n) >> 32);
+    }
+
+private:
+    // SplitMix64 finaliser, spreads seeds into well-mixed keys
+    static uint64_t mix(uint64_t v) {
+        v = (v ^ (v >> 30)) * 0xbf58476d1ce4e5b9ull;
+        v = (v ^ (v >> 27)) * 0x94d049bb133111ebull;
+        return v ^ (v >> 31);
+    }
+    
+    uint64_t m_key;
+};
+
+}
\ No newline at end of file
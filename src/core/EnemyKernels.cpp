@@ -0,0 +1,157 @@
+#include "core/EnemyKernels.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define LEGIONFALL_X64 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace Legionfall {
+
+namespace {
+#if LEGIONFALL_X64
+    void cpuid(int leaf, int subleaf, uint32_t regs[4]) {
+#if defined(_MSC_VER)
+        int r[4];
+        __cpuidex(r, leaf, subleaf);
+        for (int i = 0; i < 4; ++i) regs[i] = (uint32_t)r[i];
+#else
+        __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+    }
+    
+    // Register state the OS saves on context switch (XCR0)
+    uint64_t enabledXState() {
+#if defined(_MSC_VER)
+        return _xgetbv(0);
+#else
+        uint32_t lo, hi;
+        __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+        return ((uint64_t)hi << 32) | lo;
+#endif
+    }
+#endif
+}
+
+SimdLevel detectSimdLevel() {
+#if LEGIONFALL_X64
+    uint32_t regs[4];
+    cpuid(0, 0, regs);
+    uint32_t maxLeaf = regs[0];
+    
+    cpuid(1, 0, regs);
+    bool osxsave = (regs[2] >> 27) & 1;
+    bool avx = (regs[2] >> 28) & 1;
+    bool fma = (regs[2] >> 12) & 1;
+    if (!osxsave || !avx || maxLeaf < 7) return SimdLevel::SSE2;
+    
+    // The OS must save YMM (and for AVX-512, opmask and ZMM) registers
+    uint64_t xstate = enabledXState();
+    if ((xstate & 0x6) != 0x6) return SimdLevel::SSE2;
+    
+    cpuid(7, 0, regs);
+    bool avx2 = (regs[1] >> 5) & 1;
+    bool avx512f = (regs[1] >> 16) & 1;
+    
+    if (avx512f && (xstate & 0xE6) == 0xE6) return SimdLevel::AVX512;
+    if (avx2 && fma) return SimdLevel::AVX2;
+    return SimdLevel::SSE2;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::SSE2:   return "SSE2";
+        case SimdLevel::AVX2:   return "AVX2";
+        case SimdLevel::AVX512: return "AVX-512";
+        default:                return "scalar";
+    }
+}
+
+EnemyMoveKernel enemyMoveKernel(SimdLevel level) {
+#if LEGIONFALL_X64
+    switch (level) {
+        case SimdLevel::SSE2:   return moveEnemiesSSE2;
+        case SimdLevel::AVX2:   return moveEnemiesAVX2;
+        case SimdLevel::AVX512: return moveEnemiesAVX512;
+        default:                break;
+    }
+#else
+    (void)level;
+#endif
+    return moveEnemiesScalar;
+}
+
+void moveEnemiesScalar(const EnemyMoveBatch& batch, const EnemyMoveParams& params) {
+    float heroX = params.heroX;
+    float heroY = params.heroY;
+    float currentTime = params.time;
+    float dt = params.dt;
+    float arenaHalf = params.arenaHalf;
+    const FlowFieldView& flow = params.flow;
+    float flowMaxX = (float)flow.cellsX - 1.0f;
+    float flowMaxY = (float)flow.cellsY - 1.0f;
+    
+    for (size_t block = batch.firstBlock; block < batch.lastBlock; ++block) {
+        for (uint64_t bits = batch.alive[block]; bits != 0; bits &= bits - 1) {
+            size_t i = block * 64 + std::countr_zero(bits);
+            float x = batch.x[i];
+            float y = batch.y[i];
+            float phase = batch.phase[i];
+            
+            if (params.chaseMode) {
+                float dx = heroX - x;
+                float dy = heroY - y;
+                float dist = std::sqrt(dx * dx + dy * dy);
+                
+                if (dist > 0.1f) {
+                    dx /= dist;
+                    dy /= dist;
+                    
+                    if (flow.dirX) {
+                        float cx = std::clamp((x - flow.minX) * flow.invCellSize, 0.0f, flowMaxX);
+                        float cy = std::clamp((y - flow.minY) * flow.invCellSize, 0.0f, flowMaxY);
+                        size_t cell = (size_t)cy * flow.cellsX + (size_t)cx;
+                        float fx = flow.dirX[cell];
+                        float fy = flow.dirY[cell];
+                        if (fx * fx + fy * fy > 0.5f) { dx = fx; dy = fy; }
+                    }
+                    
+                    float wobble = std::sin(currentTime * 3.0f + phase * 2.0f) * 0.3f;
+                    dx += std::cos(phase + currentTime) * wobble * 0.5f;
+                    dy += std::sin(phase + currentTime) * wobble * 0.5f;
+                    
+                    float wobbleLen = std::sqrt(dx * dx + dy * dy);
+                    if (wobbleLen > 0.0f) { dx /= wobbleLen; dy /= wobbleLen; }
+                    
+                    x += dx * batch.chaseSpeed[i] * dt;
+                    y += dy * batch.chaseSpeed[i] * dt;
+                }
+            } else {
+                float waveX = std::sin(currentTime * 1.5f + phase) * 0.3f;
+                float waveY = std::cos(currentTime * 2.0f + phase * 1.3f) * 0.3f;
+                x = batch.baseX[i] + waveX * batch.speed[i];
+                y = batch.baseY[i] + waveY * batch.speed[i];
+            }
+            
+            if (params.heavyWork) {
+                float result = params.heavyWork(x, y);
+                x += result * 0.0001f;
+            }
+            
+            batch.x[i] = std::clamp(x, -arenaHalf, arenaHalf);
+            batch.y[i] = std::clamp(y, -arenaHalf, arenaHalf);
+        }
+    }
+}
+
+}
\ No newline at end of file
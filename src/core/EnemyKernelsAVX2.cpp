@@ -0,0 +1,61 @@
+#include "core/EnemyKernelsSimd.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include <immintrin.h>
+
+namespace Legionfall {
+
+namespace {
+    // Built with AVX2 and FMA enabled; only called when detectSimdLevel() allows
+    struct AVX2 {
+        using F = __m256;
+        using I = __m256i;
+        using M = __m256;
+        static constexpr unsigned LANES = 8;
+        
+        static F set1(float v) { return _mm256_set1_ps(v); }
+        static F load(const float* p) { return _mm256_load_ps(p); }
+        static F add(F a, F b) { return _mm256_add_ps(a, b); }
+        static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+        static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+        static F fmadd(F a, F b, F c) { return _mm256_fmadd_ps(a, b, c); }
+        static F min(F a, F b) { return _mm256_min_ps(a, b); }
+        static F max(F a, F b) { return _mm256_max_ps(a, b); }
+        static F neg(F a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+        
+        static F rsqrt(F a) {
+            F y = _mm256_rsqrt_ps(a);
+            F ayy = _mm256_mul_ps(_mm256_mul_ps(a, y), y);
+            return _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), y), _mm256_sub_ps(_mm256_set1_ps(3.0f), ayy));
+        }
+        
+        static M cmpgt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+        static F select(M m, F a, F b) { return _mm256_blendv_ps(b, a, m); }
+        
+        static I roundToInt(F a) { return _mm256_cvtps_epi32(a); }
+        static I truncToInt(F a) { return _mm256_cvttps_epi32(a); }
+        static F toFloat(I a) { return _mm256_cvtepi32_ps(a); }
+        static I addInt(I a, int b) { return _mm256_add_epi32(a, _mm256_set1_epi32(b)); }
+        static M testBits(I a, int bits) {
+            I set = _mm256_and_si256(a, _mm256_set1_epi32(bits));
+            return _mm256_castsi256_ps(_mm256_cmpeq_epi32(set, _mm256_set1_epi32(bits)));
+        }
+        static F gather(const float* base, I index) { return _mm256_i32gather_ps(base, index, 4); }
+        
+        static M maskFromBits(uint64_t bits) {
+            I laneBits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+            I set = _mm256_and_si256(_mm256_set1_epi32((int)bits), laneBits);
+            return _mm256_castsi256_ps(_mm256_cmpeq_epi32(set, laneBits));
+        }
+        
+        static void storeMasked(float* p, F v, M m) { _mm256_maskstore_ps(p, _mm256_castps_si256(m), v); }
+    };
+}
+
+void moveEnemiesAVX2(const EnemyMoveBatch& batch, const EnemyMoveParams& params) {
+    moveEnemiesSimd<AVX2>(batch, params);
+}
+
+}
+
+#endif
\ No newline at end of file
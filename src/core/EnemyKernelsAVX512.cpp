@@ -0,0 +1,57 @@
+#include "core/EnemyKernelsSimd.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include <immintrin.h>
+
+namespace Legionfall {
+
+namespace {
+    // Built with AVX-512F enabled; only called when detectSimdLevel() allows.
+    // Lane masks are native __mmask16, so dead enemies are never written.
+    struct AVX512 {
+        using F = __m512;
+        using I = __m512i;
+        using M = __mmask16;
+        static constexpr unsigned LANES = 16;
+        
+        static F set1(float v) { return _mm512_set1_ps(v); }
+        static F load(const float* p) { return _mm512_load_ps(p); }
+        static F add(F a, F b) { return _mm512_add_ps(a, b); }
+        static F sub(F a, F b) { return _mm512_sub_ps(a, b); }
+        static F mul(F a, F b) { return _mm512_mul_ps(a, b); }
+        static F fmadd(F a, F b, F c) { return _mm512_fmadd_ps(a, b, c); }
+        static F min(F a, F b) { return _mm512_min_ps(a, b); }
+        static F max(F a, F b) { return _mm512_max_ps(a, b); }
+        static F neg(F a) { return _mm512_sub_ps(_mm512_setzero_ps(), a); }
+        
+        static F rsqrt(F a) {
+            F y = _mm512_rsqrt14_ps(a);
+            F ayy = _mm512_mul_ps(_mm512_mul_ps(a, y), y);
+            return _mm512_mul_ps(_mm512_mul_ps(_mm512_set1_ps(0.5f), y), _mm512_sub_ps(_mm512_set1_ps(3.0f), ayy));
+        }
+        
+        static M cmpgt(F a, F b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+        static F select(M m, F a, F b) { return _mm512_mask_blend_ps(m, b, a); }
+        
+        static I roundToInt(F a) { return _mm512_cvtps_epi32(a); }
+        static I truncToInt(F a) { return _mm512_cvttps_epi32(a); }
+        static F toFloat(I a) { return _mm512_cvtepi32_ps(a); }
+        static I addInt(I a, int b) { return _mm512_add_epi32(a, _mm512_set1_epi32(b)); }
+        static M testBits(I a, int bits) {
+            I set = _mm512_and_si512(a, _mm512_set1_epi32(bits));
+            return _mm512_cmpeq_epi32_mask(set, _mm512_set1_epi32(bits));
+        }
+        static F gather(const float* base, I index) { return _mm512_i32gather_ps(index, base, 4); }
+        
+        static M maskFromBits(uint64_t bits) { return (M)bits; }
+        static void storeMasked(float* p, F v, M m) { _mm512_mask_store_ps(p, m, v); }
+    };
+}
+
+void moveEnemiesAVX512(const EnemyMoveBatch& batch, const EnemyMoveParams& params) {
+    moveEnemiesSimd<AVX512>(batch, params);
+}
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include "core/EnemyKernelsSimd.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include <emmintrin.h>
+
+namespace Legionfall {
+
+namespace {
+    // SSE2 is part of x86-64, so this kernel runs on every 64-bit CPU
+    struct SSE2 {
+        using F = __m128;
+        using I = __m128i;
+        using M = __m128;
+        static constexpr unsigned LANES = 4;
+        
+        static F set1(float v) { return _mm_set1_ps(v); }
+        static F load(const float* p) { return _mm_load_ps(p); }
+        static F add(F a, F b) { return _mm_add_ps(a, b); }
+        static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+        static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+        static F fmadd(F a, F b, F c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+        static F min(F a, F b) { return _mm_min_ps(a, b); }
+        static F max(F a, F b) { return _mm_max_ps(a, b); }
+        static F neg(F a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+        
+        static F rsqrt(F a) {
+            F y = _mm_rsqrt_ps(a);
+            F ayy = _mm_mul_ps(_mm_mul_ps(a, y), y);
+            return _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), y), _mm_sub_ps(_mm_set1_ps(3.0f), ayy));
+        }
+        
+        static M cmpgt(F a, F b) { return _mm_cmpgt_ps(a, b); }
+        static F select(M m, F a, F b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+        
+        static I roundToInt(F a) { return _mm_cvtps_epi32(a); }
+        static I truncToInt(F a) { return _mm_cvttps_epi32(a); }
+        static F toFloat(I a) { return _mm_cvtepi32_ps(a); }
+        static I addInt(I a, int b) { return _mm_add_epi32(a, _mm_set1_epi32(b)); }
+        static M testBits(I a, int bits) {
+            I set = _mm_and_si128(a, _mm_set1_epi32(bits));
+            return _mm_castsi128_ps(_mm_cmpeq_epi32(set, _mm_set1_epi32(bits)));
+        }
+        static F gather(const float* base, I index) {
+            alignas(16) int32_t lanes[4];
+            _mm_store_si128((I*)lanes, index);
+            return _mm_setr_ps(base[lanes[0]], base[lanes[1]], base[lanes[2]], base[lanes[3]]);
+        }
+        
+        static M maskFromBits(uint64_t bits) {
+            I laneBits = _mm_setr_epi32(1, 2, 4, 8);
+            I set = _mm_and_si128(_mm_set1_epi32((int)bits), laneBits);
+            return _mm_castsi128_ps(_mm_cmpeq_epi32(set, laneBits));
+        }
+        
+        // Only live lanes may be written: respawn fills dead slots while
+        // the move pass runs, so a blend-and-store would race with it
+        static void storeMasked(float* p, F v, M m) {
+            int bits = _mm_movemask_ps(m);
+            if (bits == 0xF) {
+                _mm_store_ps(p, v);
+                return;
+            }
+            alignas(16) float lanes[4];
+            _mm_store_ps(lanes, v);
+            for (int k = 0; k < 4; ++k) {
+                if (bits & (1 << k)) p[k] = lanes[k];
+            }
+        }
+    };
+}
+
+void moveEnemiesSSE2(const EnemyMoveBatch& batch, const EnemyMoveParams& params) {
+    moveEnemiesSimd<SSE2>(batch, params);
+}
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,156 @@
+#pragma once
+#include "core/EnemyKernels.h"
+
+// Movement kernel shared by the per-ISA translation units. Each one defines
+// a wrapper S over its intrinsics (in an anonymous namespace) and
+// instantiates moveEnemiesSimd<S>; nothing here calls inline functions from
+// other headers, so no code built for a wider ISA can leak into the rest
+// of the program through the linker.
+//
+// S provides: F (float vector), I (int vector), M (lane mask), LANES,
+// set1, load, storeMasked, add, sub, mul, fmadd, min, max, neg,
+// rsqrt, cmpgt, select, roundToInt, truncToInt, toFloat, addInt, testBits,
+// gather, maskFromBits.
+
+namespace Legionfall {
+namespace {
+
+// sin and cos of every lane: Cody-Waite reduction by pi/2, then the Cephes
+// minimax polynomials on [-pi/4, pi/4]. Accurate to a few ulp for
+// |x| < 8192, far more than the game's phases and timer reach.
+template <typename S>
+inline void sinCos(typename S::F x, typename S::F& s, typename S::F& c) {
+    using F = typename S::F;
+    using I = typename S::I;
+    
+    I q = S::roundToInt(S::mul(x, S::set1(0.636619772367581343f)));
+    F j = S::toFloat(q);
+    
+    F r = S::fmadd(j, S::set1(-1.5703125f), x);
+    r = S::fmadd(j, S::set1(-4.837512969970703125e-4f), r);
+    r = S::fmadd(j, S::set1(-7.54978995489188216e-8f), r);
+    F r2 = S::mul(r, r);
+    
+    F sp = S::fmadd(S::set1(-1.9515295891e-4f), r2, S::set1(8.3321608736e-3f));
+    sp = S::fmadd(sp, r2, S::set1(-1.6666654611e-1f));
+    sp = S::fmadd(S::mul(sp, r2), r, r);
+    
+    F cp = S::fmadd(S::set1(2.443315711809948e-5f), r2, S::set1(-1.388731625493765e-3f));
+    cp = S::fmadd(cp, r2, S::set1(4.166664568298827e-2f));
+    cp = S::fmadd(S::mul(cp, r2), r2, S::fmadd(r2, S::set1(-0.5f), S::set1(1.0f)));
+    
+    // Quadrant: odd ones swap sin and cos, then the signs follow q and q + 1
+    auto swap = S::testBits(q, 1);
+    F sinR = S::select(swap, cp, sp);
+    F cosR = S::select(swap, sp, cp);
+    s = S::select(S::testBits(q, 2), S::neg(sinR), sinR);
+    c = S::select(S::testBits(S::addInt(q, 1), 2), S::neg(cosR), cosR);
+}
+
+template <typename S>
+inline void moveEnemiesSimd(const EnemyMoveBatch& batch, const EnemyMoveParams& params) {
+    using F = typename S::F;
+    using M = typename S::M;
+    constexpr unsigned LANES = S::LANES;
+    constexpr uint64_t LANE_BITS = (1ull << LANES) - 1;
+    
+    const F heroX = S::set1(params.heroX);
+    const F heroY = S::set1(params.heroY);
+    // Time terms of the angles, rounded exactly as the scalar kernel rounds
+    // them; left to the compiler they could fuse into an fma and move by an
+    // ulp of the product, which at large times is visible in the result
+    const F time = S::set1(params.time);
+    const F wobbleTime = S::set1(params.time * 3.0f);
+    const F waveTimeX = S::set1(params.time * 1.5f);
+    const F waveTimeY = S::set1(params.time * 2.0f);
+    const F dt = S::set1(params.dt);
+    const F arenaMax = S::set1(params.arenaHalf);
+    const F arenaMin = S::set1(-params.arenaHalf);
+    const F tiny = S::set1(1e-30f);
+    const F zero = S::set1(0.0f);
+    
+    const FlowFieldView& flow = params.flow;
+    const bool useFlow = flow.dirX != nullptr;
+    const F flowMinX = S::set1(flow.minX);
+    const F flowMinY = S::set1(flow.minY);
+    const F flowInvCell = S::set1(flow.invCellSize);
+    const F flowMaxX = S::set1((float)flow.cellsX - 1.0f);
+    const F flowMaxY = S::set1((float)flow.cellsY - 1.0f);
+    const F flowCellsX = S::set1((float)flow.cellsX);
+    
+    for (size_t block = batch.firstBlock; block < batch.lastBlock; ++block) {
+        uint64_t alive = batch.alive[block];
+        if (alive == 0) continue;
+        
+        for (unsigned lane = 0; lane < 64; lane += LANES) {
+            uint64_t bits = (alive >> lane) & LANE_BITS;
+            if (bits == 0) continue;
+            
+            M live = S::maskFromBits(bits);
+            size_t i = block * 64 + lane;
+            F x = S::load(batch.x + i);
+            F y = S::load(batch.y + i);
+            F phase = S::load(batch.phase + i);
+            
+            if (params.chaseMode) {
+                F dx = S::sub(heroX, x);
+                F dy = S::sub(heroY, y);
+                F distSq = S::fmadd(dx, dx, S::mul(dy, dy));
+                M moving = S::cmpgt(distSq, S::set1(0.01f));
+                
+                F invDist = S::rsqrt(S::max(distSq, tiny));
+                dx = S::mul(dx, invDist);
+                dy = S::mul(dy, invDist);
+                
+                if (useFlow) {
+                    // Clamped cell coordinates are small non-negative integers,
+                    // so the index is exact in float
+                    F cx = S::min(S::max(S::mul(S::sub(x, flowMinX), flowInvCell), zero), flowMaxX);
+                    F cy = S::min(S::max(S::mul(S::sub(y, flowMinY), flowInvCell), zero), flowMaxY);
+                    F cell = S::fmadd(S::toFloat(S::truncToInt(cy)), flowCellsX, S::toFloat(S::truncToInt(cx)));
+                    typename S::I index = S::truncToInt(cell);
+                    F fx = S::gather(flow.dirX, index);
+                    F fy = S::gather(flow.dirY, index);
+                    M hasDirection = S::cmpgt(S::fmadd(fx, fx, S::mul(fy, fy)), S::set1(0.5f));
+                    dx = S::select(hasDirection, fx, dx);
+                    dy = S::select(hasDirection, fy, dy);
+                }
+                
+                F wobbleSin, unused;
+                sinCos<S>(S::add(wobbleTime, S::mul(phase, S::set1(2.0f))), wobbleSin, unused);
+                F wobble = S::mul(wobbleSin, S::set1(0.15f));
+                
+                F sinA, cosA;
+                sinCos<S>(S::add(phase, time), sinA, cosA);
+                dx = S::fmadd(cosA, wobble, dx);
+                dy = S::fmadd(sinA, wobble, dy);
+                
+                F lenSq = S::fmadd(dx, dx, S::mul(dy, dy));
+                F invLen = S::rsqrt(S::max(lenSq, tiny));
+                M nonZero = S::cmpgt(lenSq, zero);
+                dx = S::select(nonZero, S::mul(dx, invLen), dx);
+                dy = S::select(nonZero, S::mul(dy, invLen), dy);
+                
+                F step = S::mul(S::load(batch.chaseSpeed + i), dt);
+                x = S::select(moving, S::fmadd(dx, step, x), x);
+                y = S::select(moving, S::fmadd(dy, step, y), y);
+            } else {
+                F waveX, waveY, unused;
+                sinCos<S>(S::add(waveTimeX, phase), waveX, unused);
+                sinCos<S>(S::add(waveTimeY, S::mul(phase, S::set1(1.3f))), unused, waveY);
+                
+                F amplitude = S::mul(S::load(batch.speed + i), S::set1(0.3f));
+                x = S::fmadd(waveX, amplitude, S::load(batch.baseX + i));
+                y = S::fmadd(waveY, amplitude, S::load(batch.baseY + i));
+            }
+            
+            x = S::min(S::max(x, arenaMin), arenaMax);
+            y = S::min(S::max(y, arenaMin), arenaMax);
+            S::storeMasked(batch.x + i, x, live);
+            S::storeMasked(batch.y + i, y, live);
+        }
+    }
+}
+
+}
+}
\ No newline at end of file
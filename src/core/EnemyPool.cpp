@@ -0,0 +1,41 @@
+#include "core/EnemyPool.h"
+
+namespace Legionfall {
+
+void EnemyPool::resize(size_t count) {
+    size_t blocks = (count + BLOCK - 1) / BLOCK;
+    size_t padded = blocks * BLOCK;
+    forEachArray([padded](AlignedArray<float>& field) { field.resize(padded); });
+    
+    // Enemies past the new end must not stay alive
+    if (count < m_size) {
+        for (size_t i = count; i < std::min(m_size, padded); ++i) setAlive(i, false);
+    }
+    m_alive.resize(blocks, 0);
+    m_size = count;
+}
+
+uint64_t EnemyPool::deadMask(size_t block) const {
+    uint64_t dead = ~m_alive[block];
+    size_t valid = std::min(BLOCK, m_size - block * BLOCK);
+    if (valid < BLOCK) dead &= (uint64_t(1) << valid) - 1;
+    return dead;
+}
+
+void EnemyPool::reorder(const std::vector<uint32_t>& order) {
+    m_scratch.resize(x.size());
+    forEachArray([this, &order](AlignedArray<float>& field) {
+        for (size_t i = 0; i < order.size(); ++i) {
+            m_scratch[i] = field[order[i]];
+        }
+        field.swap(m_scratch);
+    });
+    
+    std::vector<uint64_t> alive(m_alive.size(), 0);
+    for (size_t i = 0; i < order.size(); ++i) {
+        if (isAlive(order[i])) alive[i / BLOCK] |= uint64_t(1) << (i % BLOCK);
+    }
+    m_alive.swap(alive);
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,122 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Legionfall {
+
+// Heap array aligned to a cache line, for data that passes stream through
+template <typename T>
+class AlignedArray {
+    static_assert(std::is_trivially_copyable_v<T>, "AlignedArray holds plain data only");
+
+public:
+    static constexpr size_t ALIGNMENT = 64;
+    
+    // Keeps the first min(size, count) elements; the rest are zeroed
+    void resize(size_t count) {
+        Storage data(count ? static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(ALIGNMENT))) : nullptr);
+        size_t kept = std::min(m_size, count);
+        std::copy(m_data.get(), m_data.get() + kept, data.get());
+        std::fill(data.get() + kept, data.get() + count, T{});
+        m_data = std::move(data);
+        m_size = count;
+    }
+    
+    void swap(AlignedArray& other) noexcept {
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+    }
+    
+    T* data() { return m_data.get(); }
+    const T* data() const { return m_data.get(); }
+    T& operator[](size_t i) { return m_data[i]; }
+    const T& operator[](size_t i) const { return m_data[i]; }
+    size_t size() const { return m_size; }
+
+private:
+    struct Free {
+        void operator()(T* p) const { ::operator delete(p, std::align_val_t(ALIGNMENT)); }
+    };
+    using Storage = std::unique_ptr<T[], Free>;
+    
+    Storage m_data;
+    size_t m_size = 0;
+};
+
+// All enemies, one array per field. A pass only pulls the fields it uses
+// through the cache, and every array can be read with vector loads.
+// Liveness is a bitset with one word per block of 64 enemies: passes skip
+// dead enemies a word at a time, and parallel passes split on block
+// boundaries so no two threads ever write the same word. Arrays are padded
+// to whole blocks; padding enemies are zero and never alive.
+class EnemyPool {
+public:
+    static constexpr size_t BLOCK = 64;
+    
+    // New enemies are zeroed and dead
+    void resize(size_t count);
+    void clear() { resize(0); }
+    
+    size_t size() const { return m_size; }
+    size_t blockCount() const { return m_alive.size(); }
+    
+    // Enemy indices covered by blocks [firstBlock, lastBlock)
+    size_t blockBegin(size_t firstBlock) const { return firstBlock * BLOCK; }
+    size_t blockEnd(size_t lastBlock) const { return std::min(m_size, lastBlock * BLOCK); }
+    
+    bool isAlive(size_t i) const { return (m_alive[i / BLOCK] >> (i % BLOCK)) & 1u; }
+    void setAlive(size_t i, bool alive) {
+        uint64_t bit = uint64_t(1) << (i % BLOCK);
+        if (alive) m_alive[i / BLOCK] |= bit; else m_alive[i / BLOCK] &= ~bit;
+    }
+    
+    uint64_t aliveMask(size_t block) const { return m_alive[block]; }
+    void setAliveMask(size_t block, uint64_t mask) { m_alive[block] = mask; }
+    const uint64_t* aliveMasks() const { return m_alive.data(); }
+    
+    // Dead enemies in the block, excluding padding past the end
+    uint64_t deadMask(size_t block) const;
+    
+    uint32_t aliveCount(size_t firstBlock, size_t lastBlock) const {
+        uint32_t count = 0;
+        for (size_t b = firstBlock; b < lastBlock; ++b) count += (uint32_t)std::popcount(m_alive[b]);
+        return count;
+    }
+    
+    // Moves old enemy order[i] to slot i; order must be a permutation
+    void reorder(const std::vector<uint32_t>& order);
+    
+    // Hot: touched by movement, combat and instance building
+    AlignedArray<float> x, y;
+    AlignedArray<float> phase, chaseSpeed;
+    
+    // Peaceful-mode wander
+    AlignedArray<float> baseX, baseY, speed;
+    
+    // Position last written to the instance list, drawn from for interpolation
+    AlignedArray<float> prevX, prevY;
+    
+    // Where each dead enemy fell
+    AlignedArray<float> deathX, deathY;
+
+private:
+    template <typename Fn>
+    void forEachArray(Fn&& fn) {
+        for (AlignedArray<float>* field : {&x, &y, &phase, &chaseSpeed, &baseX, &baseY, &speed, &prevX, &prevY, &deathX, &deathY}) {
+            fn(*field);
+        }
+    }
+    
+    size_t m_size = 0;
+    std::vector<uint64_t> m_alive;
+    AlignedArray<float> m_scratch;
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+#include "core/EnemyKernels.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Legionfall {
+
+class JobSystem;
+
+// Shared navigation field over the arena. Each cell stores the unit
+// direction of the shortest obstacle-free path to the target, so enemies
+// steer with one lookup and the cost of pathfinding scales with cells, not
+// enemies. Distances are solved with fast sweeping on the eikonal
+// equation, which gives straight lines in open space rather than the
+// 8-way bias of a grid search.
+//
+// Cells next to the target, blocked cells and cells that can't reach the
+// target hold a zero direction: movers should steer straight at the
+// target there.
+class FlowField {
+public:
+    void configure(float minX, float minY, float maxX, float maxY, float cellSize);
+    
+    void setBlocked(uint32_t cx, uint32_t cy, bool blocked);
+    bool isBlocked(uint32_t cx, uint32_t cy) const { return m_blocked[cy * m_cellsX + cx] != 0; }
+    void clearObstacles();
+    
+    // Recomputes the field if the target moved to another cell or the
+    // obstacles changed since the last update; returns whether it did.
+    // Every recompute solves the whole field from scratch. Warm-starting
+    // from the last distances would save no sweeps: open space already
+    // converges in one round and needs a second to confirm it. The
+    // direction pass is split over rows on the job system.
+    bool update(float targetX, float targetY, JobSystem* jobs);
+    
+    FlowFieldView view() const;
+    uint32_t cellsX() const { return m_cellsX; }
+    uint32_t cellsY() const { return m_cellsY; }
+    uint32_t updateCount() const { return m_updateCount; }
+
+private:
+    uint32_t cellX(float x) const;
+    uint32_t cellY(float y) const;
+    
+    void solveDistances(float targetX, float targetY, uint32_t targetCell);
+    void computeDirections(uint32_t firstRow, uint32_t lastRow, uint32_t targetCell);
+    bool touchesObstacle(uint32_t cx, uint32_t cy) const;
+    
+    float m_minX = 0.0f, m_minY = 0.0f;
+    float m_cellSize = 1.0f;
+    uint32_t m_cellsX = 0, m_cellsY = 0;
+    
+    std::vector<uint8_t> m_blocked;
+    std::vector<float> m_distance;
+    std::vector<float> m_dirX, m_dirY;
+    
+    uint32_t m_targetCell = UINT32_MAX;
+    uint32_t m_obstacleVersion = 0;
+    uint32_t m_builtVersion = UINT32_MAX;
+    uint32_t m_updateCount = 0;
+};
+
+}
\ No newline at end of file
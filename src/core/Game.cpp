@@ -1,16 +1,47 @@
 #include "core/Game.h"
 #include "core/JobSystem.h"
+#include "core/CounterRng.h"
 #include <cmath>
 #include <algorithm>
 #include <chrono>
-#include <random>
 #include <iostream>
+#include <thread>
+#include <bit>
 
 namespace Legionfall {
 
-static std::mt19937 s_rng(12345);
+// Spawns draw per (enemy, spawn generation) and respawns per (enemy, frame),
+// so either can be split across threads without changing what is rolled
+static const CounterRng s_spawnRng(12345, 0);
+static const CounterRng s_respawnRng(12345, 1);
 
-void Game::init(uint32_t enemyCount) {
+// Runs fn(begin, end) over [0, count) on the job system, or inline when jobs is null
+template <typename Fn>
+static void forEachRange(JobSystem* jobs, size_t count, size_t grain, Fn&& fn) {
+    if (jobs) {
+        jobs->parallelFor(0, count, grain, fn);
+    } else if (count > 0) {
+        fn(size_t(0), count);
+    }
+}
+
+// As above, but the governor picks how the range is split and learns from its timing
+template <typename Fn>
+static void forEachRange(JobSystem* jobs, ParallelGovernor& governor, size_t count, Fn&& fn) {
+    if (jobs) {
+        governor.run(*jobs, count, fn);
+    } else if (count > 0) {
+        fn(size_t(0), count);
+    }
+}
+
+Game::~Game() {
+    stopBackgroundWork();
+}
+
+void Game::init(uint32_t enemyCount, JobSystem* jobs) {
+    // Instance targets are sized for at most MAX_ENEMIES
+    enemyCount = std::min(enemyCount, MAX_ENEMIES);
     m_initialEnemyCount = enemyCount;
     m_targetEnemyCount = enemyCount;
     
@@ -25,31 +56,46 @@ void Game::init(uint32_t enemyCount) {
     m_hero.pulsePhase = 0.0f;
 
     m_enemies.clear();
-    spawnEnemiesInGrid(enemyCount);
-    rebuildInstances();
+    spawnEnemiesInGrid(enemyCount, jobs);
+    m_spawnGeneration++;
+    m_grid.configure(-ARENA_HALF, -ARENA_HALF, ARENA_HALF, ARENA_HALF, GRID_CELL_SIZE);
+    m_flowField.configure(-ARENA_HALF, -ARENA_HALF, ARENA_HALF, ARENA_HALF, FLOW_CELL_SIZE);
+    buildGrid(nullptr);
+    rebuildInstances(nullptr);
+    
+    // The arena never changes, so restarts keep what the renderer uploaded
+    if (m_staticInstances.empty()) buildStaticInstances();
 
     m_stats.enemyCount = enemyCount;
     m_stats.parallelEnabled = m_parallelEnabled;
     m_stats.heavyWorkEnabled = m_heavyWorkEnabled;
     m_stats.cameraFollowEnabled = m_cameraFollowEnabled;
     m_stats.chaseModeEnabled = m_chaseModeEnabled;
+    m_stats.simdKernel = simdLevelName(m_simdLevel);
     m_time = 0.0f;
+    m_frameIndex = 0;
 }
 
-void Game::restart() {
-    init(m_targetEnemyCount);
+void Game::restart(JobSystem* jobs) {
+    init(m_targetEnemyCount, jobs);
 }
 
-void Game::adjustEnemyCount(int delta) {
+void Game::adjustEnemyCount(int delta, JobSystem* jobs) {
     int newCount = (int)m_targetEnemyCount + delta;
     newCount = std::clamp(newCount, (int)MIN_ENEMIES, (int)MAX_ENEMIES);
     m_targetEnemyCount = (uint32_t)newCount;
     
     // Reinitialize with new count
-    init(m_targetEnemyCount);
+    init(m_targetEnemyCount, jobs);
     std::cout << "[Game] Enemy count adjusted to: " << m_targetEnemyCount << std::endl;
 }
 
+void Game::setSimdLevel(SimdLevel level) {
+    m_simdLevel = std::min(level, detectSimdLevel());
+    m_moveKernel = enemyMoveKernel(m_simdLevel);
+    m_stats.simdKernel = simdLevelName(m_simdLevel);
+}
+
 void Game::update(float dt, const InputState& input, JobSystem* jobs) {
     // Handle toggle inputs
     if (input.toggleParallel && !m_toggleParallelPressed) {
@@ -76,42 +122,65 @@ void Game::update(float dt, const InputState& input, JobSystem* jobs) {
     }
     m_toggleChasePressed = input.toggleChaseMode;
     
+    // Every per-enemy pass goes through the job system unless parallel mode is off
+    JobSystem* frameJobs = (m_parallelEnabled && jobs != nullptr && jobs->threadCount() > 0) ? jobs : nullptr;
+    
     // Handle enemy count adjustment
     if (input.increaseEnemies && !m_increasePressed) {
-        adjustEnemyCount(1000);
+        adjustEnemyCount(1000, frameJobs);
     }
     m_increasePressed = input.increaseEnemies;
     
     if (input.decreaseEnemies && !m_decreasePressed) {
-        adjustEnemyCount(-1000);
+        adjustEnemyCount(-1000, frameJobs);
     }
     m_decreasePressed = input.decreaseEnemies;
 
+    if (jobs != nullptr) {
+        const JobSystemConfig& config = jobs->config();
+        m_stats.workerCount = config.workerCount;
+        m_stats.backgroundWorkers = config.backgroundWorkers;
+        m_stats.workersPinned = config.pinWorkers;
+        m_stats.spinMicros = config.spinMicros;
+        m_stats.yieldMicros = config.yieldMicros;
+    }
+
+    // Resume coroutines whose frame has come before anything else touches the enemies
+    if (jobs != nullptr && jobs->threadCount() > 0) {
+        TraceSpan span(&jobs->trace(), "frameBoundary");
+        if (m_backgroundJobs == nullptr) {
+            m_backgroundJobs = jobs;
+            spawn(*jobs, resortEnemiesLoop(*jobs), m_backgroundCounter);
+        }
+        m_frames.advance(*m_backgroundJobs, m_boundaryCounter);
+        m_backgroundJobs->wait(m_boundaryCounter);
+    }
+
+    // Interpolation runs from here to wherever this tick leaves the hero
+    m_hero.prevX = m_hero.x;
+    m_hero.prevY = m_hero.y;
+    
     // Don't update if game over
     if (m_hero.health <= 0) {
-        rebuildInstances();
+        rebuildInstances(frameJobs);
         return;
     }
 
     m_time += dt;
+    m_frameIndex++;
     
-    updateHero(dt, input);
-    
-    // Time enemy updates
-    auto startUpdate = std::chrono::high_resolution_clock::now();
-    
-    if (m_parallelEnabled && jobs != nullptr && jobs->threadCount() > 0) {
-        updateEnemiesParallel(dt, jobs);
-        m_stats.threadCount = jobs->threadCount();
-    } else {
-        updateEnemiesSingleThreaded(dt);
-        m_stats.threadCount = 1;
+    m_frameDt = dt;
+    m_frameInput = &input;
+    m_frameJobs = frameJobs;
+    if (m_frameGraph.size() == 0) {
+        buildFrameGraph();
     }
-    
-    auto endUpdate = std::chrono::high_resolution_clock::now();
-    m_stats.updateTimeMs = std::chrono::duration<double, std::milli>(endUpdate - startUpdate).count();
-    
-    checkCollisions();
+    m_frameGraph.run(frameJobs);
+    m_stats.threadCount = frameJobs ? frameJobs->threadCount() : 1;
+    m_stats.moveGovernor = m_moveGovernor.stats();
+    m_stats.separateGovernor = m_separateGovernor.stats();
+    m_stats.flowFieldUpdates = m_flowField.updateCount();
+    m_stats.simdKernel = m_heavyWorkEnabled ? simdLevelName(SimdLevel::Scalar) : simdLevelName(m_simdLevel);
     
     // Update stats
     m_stats.heroX = m_hero.x;
@@ -119,11 +188,40 @@ void Game::update(float dt, const InputState& input, JobSystem* jobs) {
     m_stats.killCount = m_hero.killCount;
     m_stats.heroHealth = m_hero.health;
     m_stats.waveNumber = m_hero.waveNumber;
-    
-    rebuildInstances();
 }
 
-void Game::updateHero(float dt, const InputState& input) {
+void Game::buildFrameGraph() {
+    auto hero = m_frameGraph.add("hero", [this] { updateHero(m_frameDt, *m_frameInput, m_frameJobs); });
+    
+    // Only does work when the hero has moved to another cell
+    auto flow = m_frameGraph.add("flowField", [this] { m_flowField.update(m_hero.x, m_hero.y, m_frameJobs); }, {hero});
+    
+    // Movement only touches live enemies and respawning only dead ones, so
+    // the two overlap; respawned enemies join the live set once both finish
+    auto move = m_frameGraph.add("move", [this] {
+        auto startUpdate = std::chrono::high_resolution_clock::now();
+        if (m_frameJobs) {
+            updateEnemiesParallel(m_frameDt, m_frameJobs);
+        } else {
+            updateEnemiesSingleThreaded(m_frameDt);
+        }
+        auto endUpdate = std::chrono::high_resolution_clock::now();
+        m_stats.updateTimeMs = std::chrono::duration<double, std::milli>(endUpdate - startUpdate).count();
+    }, {flow});
+    auto respawn = m_frameGraph.add("respawn", [this] { stageRespawns(m_frameDt, m_frameJobs); }, {hero});
+    auto revive = m_frameGraph.add("revive", [this] { reviveStagedEnemies(); }, {move, respawn});
+    
+    // Collisions never change who is alive, so instance slots can be counted
+    // alongside them; boundary and shockwave only depend on the hero
+    auto grid = m_frameGraph.add("grid", [this] { buildGrid(m_frameJobs); }, {revive});
+    auto separate = m_frameGraph.add("separate", [this] { separateEnemies(m_frameDt, m_frameJobs); }, {grid});
+    auto collide = m_frameGraph.add("collide", [this] { checkCollisions(m_frameJobs); }, {separate});
+    auto count = m_frameGraph.add("countAlive", [this] { countAliveChunks(m_frameJobs); }, {revive});
+    auto effects = m_frameGraph.add("effects", [this] { buildEffectInstances(); }, {hero});
+    m_frameGraph.add("writeInstances", [this] { writeInstances(m_frameJobs); }, {collide, count, effects});
+}
+
+void Game::updateHero(float dt, const InputState& input, JobSystem* jobs) {
     m_hero.pulsePhase += dt * 4.0f;
     if (m_hero.pulsePhase > 6.28318f) m_hero.pulsePhase -= 6.28318f;
     
@@ -149,7 +247,7 @@ void Game::updateHero(float dt, const InputState& input) {
     if (input.attack && m_hero.attackCooldown <= 0.0f) {
         m_hero.attackTriggered = true;
         m_hero.attackCooldown = m_hero.attackCooldownMax;
-        performAttack();
+        performAttack(jobs);
     }
     
     float vx = 0.0f, vy = 0.0f;
@@ -172,230 +270,268 @@ void Game::updateHero(float dt, const InputState& input) {
     m_hero.y = std::clamp(m_hero.y, -ARENA_HALF + 0.5f, ARENA_HALF - 0.5f);
 }
 
-void Game::performAttack() {
+void Game::performAttack(JobSystem* jobs) {
     m_hero.shockwaveRadius = 0.5f;
     m_hero.shockwaveAlpha = 1.0f;
     
+    float heroX = m_hero.x;
+    float heroY = m_hero.y;
     float attackRadiusSq = m_hero.attackRadius * m_hero.attackRadius;
-    int killsThisAttack = 0;
     
-    for (auto& e : m_enemies) {
-        if (!e.alive) continue;
-        
-        float dx = e.x - m_hero.x;
-        float dy = e.y - m_hero.y;
-        float distSq = dx * dx + dy * dy;
-        
-        if (distSq < attackRadiusSq) {
-            e.alive = false;
-            e.deathTimer = RESPAWN_DELAY;
-            e.deathX = e.x;
-            e.deathY = e.y;
-            m_hero.killCount++;
-            killsThisAttack++;
+    // Enemies may have been moved off their grid positions since the build.
+    // Runs only record their kills; the alive bits, which runs share, are
+    // cleared afterwards in run order.
+    EnemyPool& enemies = m_enemies;
+    m_grid.runsInRadius(heroX, heroY, m_hero.attackRadius + SEPARATION_MAX_STEP + CONTACT_PUSH, QUERY_RUN, m_queryRuns);
+    m_runCounts.assign(m_queryRuns.size(), 0);
+    m_runKills.resize(m_grid.entryCount());
+    
+    forEachRange(jobs, m_queryRuns.size(), 1, [&](size_t first, size_t last) {
+        for (size_t run = first; run < last; ++run) {
+            uint32_t kills = 0;
+            for (uint32_t slot = m_queryRuns[run].begin; slot < m_queryRuns[run].end; ++slot) {
+                uint32_t i = m_grid.entryIndex(slot);
+                if (!enemies.isAlive(i)) continue;
+                
+                float dx = enemies.x[i] - heroX;
+                float dy = enemies.y[i] - heroY;
+                float distSq = dx * dx + dy * dy;
+                
+                if (distSq < attackRadiusSq) {
+                    enemies.deathX[i] = enemies.x[i];
+                    enemies.deathY[i] = enemies.y[i];
+                    m_runKills[m_queryRuns[run].begin + kills++] = i;
+                }
+            }
+            m_runCounts[run] = kills;
         }
+    });
+    
+    uint32_t killsThisAttack = 0;
+    for (size_t run = 0; run < m_queryRuns.size(); ++run) {
+        for (uint32_t k = 0; k < m_runCounts[run]; ++k) {
+            uint32_t i = m_runKills[m_queryRuns[run].begin + k];
+            enemies.setAlive(i, false);
+            m_respawns.push(i, RESPAWN_DELAY);
+        }
+        killsThisAttack += m_runCounts[run];
     }
+    m_hero.killCount += (int)killsThisAttack;
     
     // Wave progression: every 100 kills, increase difficulty
     int newWave = (m_hero.killCount / 100) + 1;
     if (newWave > m_hero.waveNumber) {
         m_hero.waveNumber = newWave;
         // Enemies get faster each wave
-        for (auto& e : m_enemies) {
-            e.chaseSpeed *= 1.05f;
-        }
+        forEachRange(jobs, m_enemies.size(), 0, [this](size_t begin, size_t end) {
+            float* chaseSpeed = m_enemies.chaseSpeed.data();
+            for (size_t i = begin; i < end; ++i) {
+                chaseSpeed[i] *= 1.05f;
+            }
+        });
     }
 }
 
-void Game::checkCollisions() {
-    if (!m_chaseModeEnabled) return;
-    
-    float heroRadiusSq = m_hero.radius * m_hero.radius;
-    
-    for (auto& e : m_enemies) {
-        if (!e.alive) continue;
-        
-        float dx = e.x - m_hero.x;
-        float dy = e.y - m_hero.y;
-        float distSq = dx * dx + dy * dy;
-        
-        if (distSq < heroRadiusSq) {
-            m_hero.health -= 1;
-            m_hero.damageFlash = 1.0f;
-            
-            float dist = std::sqrt(distSq);
-            if (dist > 0.01f) {
-                e.x += (dx / dist) * 0.5f;
-                e.y += (dy / dist) * 0.5f;
-            }
-        }
-    }
-    
-    if (m_hero.health < 0) m_hero.health = 0;
+// Counting sort of the alive enemies into the grid, in fixed chunks of blocks
+void Game::buildGrid(JobSystem* jobs) {
+    m_grid.build(m_enemies, [jobs](size_t count, auto&& fn) { forEachRange(jobs, count, 1, fn); });
 }
 
-void Game::respawnEnemy(Enemy& e) {
-    std::uniform_real_distribution<float> edgeDist(-ARENA_HALF + 0.5f, ARENA_HALF - 0.5f);
-    std::uniform_int_distribution<int> sideDist(0, 3);
-    std::uniform_real_distribution<float> phaseDist(0.0f, 6.28318f);
-    
-    // Chase speed increases with wave
-    float baseSpeed = 1.5f + m_hero.waveNumber * 0.2f;
-    float maxSpeed = 4.0f + m_hero.waveNumber * 0.3f;
-    std::uniform_real_distribution<float> chaseSpeedDist(baseSpeed, maxSpeed);
-    
-    int side = sideDist(s_rng);
-    float pos = edgeDist(s_rng);
-    
-    switch (side) {
-        case 0: e.x = -ARENA_HALF + 0.2f; e.y = pos; break;
-        case 1: e.x = ARENA_HALF - 0.2f;  e.y = pos; break;
-        case 2: e.x = pos; e.y = -ARENA_HALF + 0.2f; break;
-        case 3: e.x = pos; e.y = ARENA_HALF - 0.2f;  break;
-    }
+// Pushes crowded enemies apart. Neighbours are read from the grid's copy
+// of the positions and each enemy writes only its own, so grid entries can
+// be split across threads freely and the result doesn't depend on the split.
+// Splitting entries rather than cells keeps the load even when the whole
+// swarm sits in a few cells around the hero.
+void Game::separateEnemies(float dt, JobSystem* jobs) {
+    if (!m_chaseModeEnabled) return;
     
-    e.baseX = e.x;
-    e.baseY = e.y;
-    e.phase = phaseDist(s_rng);
-    e.chaseSpeed = chaseSpeedDist(s_rng);
-    e.alive = true;
-    e.deathTimer = 0.0f;
+    forEachRange(jobs, m_separateGovernor, m_grid.entryCount(), [this, dt](size_t first, size_t last) {
+        separateEntries((uint32_t)first, (uint32_t)last, dt);
+    });
 }
 
-void Game::updateEnemiesSingleThreaded(float dt) {
-    float heroX = m_hero.x;
-    float heroY = m_hero.y;
-    float currentTime = m_time;
-    bool chaseMode = m_chaseModeEnabled;
-    bool heavyWork = m_heavyWorkEnabled;
-    
-    for (size_t i = 0; i < m_enemies.size(); ++i) {
-        Enemy& e = m_enemies[i];
+void Game::separateEntries(uint32_t firstSlot, uint32_t lastSlot, float dt) {
+    const SpatialGrid& grid = m_grid;
+    const float radiusSq = SEPARATION_RADIUS * SEPARATION_RADIUS;
+    const float invRadius = 1.0f / SEPARATION_RADIUS;
+    float* ex = m_enemies.x.data();
+    float* ey = m_enemies.y.data();
+    
+    for (uint32_t slot = firstSlot; slot < lastSlot; ++slot) {
+        float x = grid.entryX(slot);
+        float y = grid.entryY(slot);
+        uint32_t x0 = grid.cellX(x - SEPARATION_RADIUS), x1 = grid.cellX(x + SEPARATION_RADIUS);
+        uint32_t y0 = grid.cellY(y - SEPARATION_RADIUS), y1 = grid.cellY(y + SEPARATION_RADIUS);
         
-        if (!e.alive) {
-            e.deathTimer -= dt;
-            if (e.deathTimer <= 0.0f) respawnEnemy(e);
-            continue;
-        }
+        // Split the candidate budget between the cells the radius touches
+        // and start each scan at a different entry per enemy, so a crowded
+        // cell doesn't hand every enemy the same few neighbours
+        uint32_t perCell = SEPARATION_CANDIDATES / ((x1 - x0 + 1) * (y1 - y0 + 1));
+        float pushX = 0.0f, pushY = 0.0f;
+        uint32_t neighbours = 0;
         
-        if (chaseMode) {
-            float dx = heroX - e.x;
-            float dy = heroY - e.y;
-            float dist = std::sqrt(dx * dx + dy * dy);
-            
-            if (dist > 0.1f) {
-                dx /= dist;
-                dy /= dist;
+        for (uint32_t cy = y0; cy <= y1 && neighbours < SEPARATION_NEIGHBOURS; ++cy) {
+            for (uint32_t cx = x0; cx <= x1 && neighbours < SEPARATION_NEIGHBOURS; ++cx) {
+                size_t other = (size_t)cy * grid.cellsX() + cx;
+                uint32_t begin = grid.cellBegin(other);
+                uint32_t count = grid.cellEnd(other) - begin;
+                if (count == 0) continue;
                 
-                float wobble = std::sin(currentTime * 3.0f + e.phase * 2.0f) * 0.3f;
-                dx += std::cos(e.phase + currentTime) * wobble * 0.5f;
-                dy += std::sin(e.phase + currentTime) * wobble * 0.5f;
-                
-                float wobbleLen = std::sqrt(dx * dx + dy * dy);
-                if (wobbleLen > 0.0f) { dx /= wobbleLen; dy /= wobbleLen; }
-                
-                e.x += dx * e.chaseSpeed * dt;
-                e.y += dy * e.chaseSpeed * dt;
+                uint32_t visits = std::min(count, perCell);
+                uint32_t start = slot % count;
+                for (uint32_t k = 0, candidate = begin + start; k < visits; ++k, ++candidate) {
+                    if (candidate == begin + count) candidate = begin;
+                    if (candidate == slot) continue;
+                    
+                    float dx = x - grid.entryX(candidate);
+                    float dy = y - grid.entryY(candidate);
+                    float distSq = dx * dx + dy * dy;
+                    if (distSq >= radiusSq || distSq < 1e-8f) continue;
+                    
+                    // Closer neighbours push harder, fading to nothing at the radius
+                    float dist = std::sqrt(distSq);
+                    float weight = (1.0f - dist * invRadius) / dist;
+                    pushX += dx * weight;
+                    pushY += dy * weight;
+                    if (++neighbours == SEPARATION_NEIGHBOURS) break;
+                }
             }
-        } else {
-            float waveX = std::sin(currentTime * 1.5f + e.phase) * 0.3f;
-            float waveY = std::cos(currentTime * 2.0f + e.phase * 1.3f) * 0.3f;
-            e.x = e.baseX + waveX * e.speed;
-            e.y = e.baseY + waveY * e.speed;
         }
+        if (neighbours == 0) continue;
         
-        if (heavyWork) {
-            float result = doHeavyWork(e.x, e.y);
-            e.x += result * 0.0001f;
+        float stepX = pushX * SEPARATION_SPEED * dt;
+        float stepY = pushY * SEPARATION_SPEED * dt;
+        float stepSq = stepX * stepX + stepY * stepY;
+        if (stepSq > SEPARATION_MAX_STEP * SEPARATION_MAX_STEP) {
+            float scale = SEPARATION_MAX_STEP / std::sqrt(stepSq);
+            stepX *= scale;
+            stepY *= scale;
         }
         
-        e.x = std::clamp(e.x, -ARENA_HALF, ARENA_HALF);
-        e.y = std::clamp(e.y, -ARENA_HALF, ARENA_HALF);
+        uint32_t i = grid.entryIndex(slot);
+        ex[i] = std::clamp(x + stepX, -ARENA_HALF, ARENA_HALF);
+        ey[i] = std::clamp(y + stepY, -ARENA_HALF, ARENA_HALF);
     }
 }
 
-void Game::updateEnemiesParallel(float dt, JobSystem* jobs) {
-    size_t enemyCount = m_enemies.size();
-    if (enemyCount == 0) return;
-    
-    size_t numJobs = std::min(jobs->threadCount(), size_t(8));
-    numJobs = std::max(numJobs, size_t(1));
-    
-    if (enemyCount < numJobs * 50) {
-        updateEnemiesSingleThreaded(dt);
-        return;
-    }
-    
-    size_t perJob = enemyCount / numJobs;
-    size_t remainder = enemyCount % numJobs;
+// Each enemy only pushes itself back, so runs only share the hit count,
+// which is summed in run order afterwards
+void Game::checkCollisions(JobSystem* jobs) {
+    if (!m_chaseModeEnabled) return;
     
     float heroX = m_hero.x;
     float heroY = m_hero.y;
-    float currentTime = m_time;
-    bool chaseMode = m_chaseModeEnabled;
-    bool heavyWork = m_heavyWorkEnabled;
-    float deltaTime = dt;
-    
-    size_t start = 0;
-    for (size_t i = 0; i < numJobs; ++i) {
-        size_t count = perJob + (i < remainder ? 1 : 0);
-        size_t end = start + count;
+    float heroRadiusSq = m_hero.radius * m_hero.radius;
+    
+    // Separation may have moved enemies since the grid was built
+    m_grid.runsInRadius(heroX, heroY, m_hero.radius + SEPARATION_MAX_STEP, QUERY_RUN, m_queryRuns);
+    m_runCounts.assign(m_queryRuns.size(), 0);
+    
+    forEachRange(jobs, m_queryRuns.size(), 1, [&](size_t first, size_t last) {
+        float* ex = m_enemies.x.data();
+        float* ey = m_enemies.y.data();
         
-        jobs->schedule([this, start, end, heroX, heroY, currentTime, chaseMode, heavyWork, deltaTime]() {
-            for (size_t j = start; j < end; ++j) {
-                Enemy& e = m_enemies[j];
-                if (!e.alive) continue;
+        for (size_t run = first; run < last; ++run) {
+            uint32_t runHits = 0;
+            for (uint32_t slot = m_queryRuns[run].begin; slot < m_queryRuns[run].end; ++slot) {
+                uint32_t i = m_grid.entryIndex(slot);
+                float dx = ex[i] - heroX;
+                float dy = ey[i] - heroY;
+                float distSq = dx * dx + dy * dy;
                 
-                if (chaseMode) {
-                    float dx = heroX - e.x;
-                    float dy = heroY - e.y;
-                    float dist = std::sqrt(dx * dx + dy * dy);
+                if (distSq < heroRadiusSq) {
+                    runHits++;
                     
-                    if (dist > 0.1f) {
-                        dx /= dist;
-                        dy /= dist;
-                        
-                        float wobble = std::sin(currentTime * 3.0f + e.phase * 2.0f) * 0.3f;
-                        dx += std::cos(e.phase + currentTime) * wobble * 0.5f;
-                        dy += std::sin(e.phase + currentTime) * wobble * 0.5f;
-                        
-                        float wobbleLen = std::sqrt(dx * dx + dy * dy);
-                        if (wobbleLen > 0.0f) { dx /= wobbleLen; dy /= wobbleLen; }
-                        
-                        e.x += dx * e.chaseSpeed * deltaTime;
-                        e.y += dy * e.chaseSpeed * deltaTime;
+                    float dist = std::sqrt(distSq);
+                    if (dist > 0.01f) {
+                        ex[i] += (dx / dist) * CONTACT_PUSH;
+                        ey[i] += (dy / dist) * CONTACT_PUSH;
                     }
-                } else {
-                    float waveX = std::sin(currentTime * 1.5f + e.phase) * 0.3f;
-                    float waveY = std::cos(currentTime * 2.0f + e.phase * 1.3f) * 0.3f;
-                    e.x = e.baseX + waveX * e.speed;
-                    e.y = e.baseY + waveY * e.speed;
                 }
-                
-                if (heavyWork) {
-                    float result = 0.0f;
-                    for (int k = 0; k < 50; ++k) {
-                        result += std::sin(e.x * (float)k * 0.1f) * std::cos(e.y * (float)k * 0.1f);
-                        result = std::tanh(result);
-                    }
-                    e.x += result * 0.0001f;
-                }
-                
-                e.x = std::clamp(e.x, -ARENA_HALF, ARENA_HALF);
-                e.y = std::clamp(e.y, -ARENA_HALF, ARENA_HALF);
             }
-        });
-        
-        start = end;
+            m_runCounts[run] = runHits;
+        }
+    });
+    
+    uint32_t hits = 0;
+    for (uint32_t runHits : m_runCounts) hits += runHits;
+    
+    if (hits > 0) {
+        m_hero.health -= (int)hits;
+        m_hero.damageFlash = 1.0f;
     }
+    if (m_hero.health < 0) m_hero.health = 0;
+}
+
+void Game::respawnEnemy(uint32_t i) {
+    // Chase speed increases with wave
+    float baseSpeed = 1.5f + m_hero.waveNumber * 0.2f;
+    float maxSpeed = 4.0f + m_hero.waveNumber * 0.3f;
+    
+    uint32_t side = s_respawnRng.below(CounterRng::counter(i, m_frameIndex, 0), 4);
+    float pos = s_respawnRng.uniform(CounterRng::counter(i, m_frameIndex, 1), -ARENA_HALF + 0.5f, ARENA_HALF - 0.5f);
+    float x = 0.0f, y = 0.0f;
     
-    jobs->wait();
+    switch (side) {
+        case 0: x = -ARENA_HALF + 0.2f; y = pos; break;
+        case 1: x = ARENA_HALF - 0.2f;  y = pos; break;
+        case 2: x = pos; y = -ARENA_HALF + 0.2f; break;
+        case 3: x = pos; y = ARENA_HALF - 0.2f;  break;
+    }
     
-    for (auto& e : m_enemies) {
-        if (!e.alive) {
-            e.deathTimer -= dt;
-            if (e.deathTimer <= 0.0f) respawnEnemy(e);
+    m_enemies.x[i] = x;
+    m_enemies.y[i] = y;
+    m_enemies.baseX[i] = x;
+    m_enemies.baseY[i] = y;
+    m_enemies.prevX[i] = x;
+    m_enemies.prevY[i] = y;
+    m_enemies.phase[i] = s_respawnRng.uniform(CounterRng::counter(i, m_frameIndex, 2), 0.0f, 6.28318f);
+    m_enemies.chaseSpeed[i] = s_respawnRng.uniform(CounterRng::counter(i, m_frameIndex, 3), baseSpeed, maxSpeed);
+}
+
+void Game::updateEnemiesSingleThreaded(float dt) {
+    updateEnemyBlocks(0, m_enemies.blockCount(), dt);
+}
+
+void Game::updateEnemiesParallel(float dt, JobSystem* jobs) {
+    forEachRange(jobs, m_moveGovernor, m_enemies.blockCount(), [this, dt](size_t first, size_t last) {
+        updateEnemyBlocks(first, last, dt);
+    });
+}
+
+void Game::updateEnemyBlocks(size_t firstBlock, size_t lastBlock, float dt) {
+    EnemyMoveBatch batch{
+        m_enemies.x.data(), m_enemies.y.data(),
+        m_enemies.phase.data(), m_enemies.chaseSpeed.data(),
+        m_enemies.baseX.data(), m_enemies.baseY.data(), m_enemies.speed.data(),
+        m_enemies.aliveMasks(), firstBlock, lastBlock
+    };
+    
+    EnemyMoveParams params{m_hero.x, m_hero.y, m_time, dt, ARENA_HALF, m_chaseModeEnabled, m_flowField.view()};
+    if (m_heavyWorkEnabled) {
+        params.heavyWork = doHeavyWork;
+        moveEnemiesScalar(batch, params);
+    } else {
+        m_moveKernel(batch, params);
+    }
+}
+
+// Re-rolls the enemies whose respawn time has come. They stay dead until
+// reviveStagedEnemies so concurrent movement never sees them.
+void Game::stageRespawns(float dt, JobSystem* jobs) {
+    m_stagedRespawns.clear();
+    m_respawns.advance(dt, m_stagedRespawns);
+    
+    forEachRange(jobs, m_stagedRespawns.size(), 0, [this](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+            respawnEnemy(m_stagedRespawns[k]);
         }
+    });
+}
+
+void Game::reviveStagedEnemies() {
+    for (uint32_t i : m_stagedRespawns) {
+        m_enemies.setAlive(i, true);
     }
 }
 
@@ -408,46 +544,130 @@ float Game::doHeavyWork(float x, float y) {
     return result;
 }
 
+// Keeps advancing frames until every background coroutine has returned
+void Game::stopBackgroundWork() {
+    if (m_backgroundJobs == nullptr) return;
+    
+    m_stopBackground.store(true, std::memory_order_relaxed);
+    while (m_backgroundCounter.pending.load(std::memory_order_acquire) > 0) {
+        m_frames.advance(*m_backgroundJobs, m_boundaryCounter);
+        m_backgroundJobs->wait(m_boundaryCounter);
+        std::this_thread::yield();
+    }
+    m_backgroundJobs = nullptr;
+}
+
+// Periodically reorders enemies by grid cell. Keys are taken at one frame
+// boundary and the new order applied RESORT_APPLY_DELAY_FRAMES boundaries
+// later; the sort runs as background work in between, and a late sort
+// holds the apply boundary open until it finishes. The result depends
+// only on the frame count, never on how quickly the sort got a worker.
+Task<void> Game::resortEnemiesLoop(JobSystem& jobs) {
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> order;
+    AwaitableCounter sorted;
+    const uint32_t cellsPerRow = (uint32_t)(ARENA_HALF * 2.0f / RESORT_CELL_SIZE) + 1;
+    
+    // Contact pushes can leave enemies just outside the arena, so clamp
+    // before converting, as SpatialGrid does
+    auto cellOf = [maxCell = (float)(cellsPerRow - 1)](float v) {
+        float cell = (v + ARENA_HALF) / RESORT_CELL_SIZE;
+        if (!(cell > 0.0f)) return 0u;
+        return (uint32_t)std::min(cell, maxCell);
+    };
+    
+    while (true) {
+        co_await m_frames.delay(RESORT_INTERVAL_FRAMES);
+        if (m_stopBackground.load(std::memory_order_relaxed)) co_return;
+        
+        uint64_t applyFrame = m_frames.current() + RESORT_APPLY_DELAY_FRAMES;
+        uint32_t generation = m_spawnGeneration;
+        keys.resize(m_enemies.size());
+        for (size_t i = 0; i < m_enemies.size(); ++i) {
+            uint32_t cell = cellOf(m_enemies.y[i]) * cellsPerRow + cellOf(m_enemies.x[i]);
+            keys[i] = ((uint64_t)cell << 32) | (uint64_t)i;
+        }
+        
+        sorted.open(jobs);
+        jobs.schedule([&jobs, &keys, &order]() {
+            TraceSpan span(&jobs.trace(), "resortEnemies");
+            std::sort(keys.begin(), keys.end());
+            order.resize(keys.size());
+            for (size_t i = 0; i < keys.size(); ++i) {
+                order[i] = (uint32_t)keys[i];
+            }
+        }, sorted.counter(), JobPriority::Background);
+        sorted.close();
+        
+        // Resumed as part of that frame's boundary job. The extra unit keeps
+        // the boundary open, and the game thread waiting on it, until the
+        // order is applied, even if the sort finishes later and resumes us
+        // from another job; no thread is parked in the meantime.
+        co_await m_frames.until(applyFrame);
+        m_boundaryCounter.pending.fetch_add(1, std::memory_order_relaxed);
+        co_await sorted;
+        
+        // A restart or count change in the meantime makes the order meaningless
+        bool stopping = m_stopBackground.load(std::memory_order_relaxed);
+        if (!stopping && generation == m_spawnGeneration && order.size() == m_enemies.size()) {
+            m_enemies.reorder(order);
+            m_respawns.remap(order);
+            buildGrid(&jobs);
+        }
+        jobs.signal(m_boundaryCounter);
+        if (stopping) co_return;
+    }
+}
+
+void Game::buildStaticInstances() {
+    m_staticInstances.clear();
+    addArenaBoundaryInstances();
+    
+    // Static instances are drawn where they are
+    for (InstanceData& instance : m_staticInstances) {
+        instance.prevX = instance.offsetX;
+        instance.prevY = instance.offsetY;
+    }
+}
+
 void Game::addArenaBoundaryInstances() {
     // Create visible boundary markers around the arena
     float boundaryScale = 0.15f;
     float spacing = 1.0f;
     
-    // Pulsing boundary color
-    float pulse = std::sin(m_time * 2.0f) * 0.3f + 0.5f;
-    
+    // Base colour; the shader adds the pulse to green
     for (float pos = -ARENA_HALF; pos <= ARENA_HALF; pos += spacing) {
         // Top edge
         InstanceData top{};
-        top.offsetX = pos;
-        top.offsetY = ARENA_HALF;
-        top.colorR = 0.2f; top.colorG = 0.3f + pulse * 0.2f; top.colorB = 0.5f;
-        top.scale = boundaryScale;
-        m_instances.push_back(top);
+        top.setPosition(pos, ARENA_HALF);
+        top.type = InstanceType::Boundary;
+        top.setColor(0.2f, 0.3f, 0.5f);
+        top.setScale(boundaryScale);
+        m_staticInstances.push_back(top);
         
         // Bottom edge
         InstanceData bottom{};
-        bottom.offsetX = pos;
-        bottom.offsetY = -ARENA_HALF;
-        bottom.colorR = 0.2f; bottom.colorG = 0.3f + pulse * 0.2f; bottom.colorB = 0.5f;
-        bottom.scale = boundaryScale;
-        m_instances.push_back(bottom);
+        bottom.setPosition(pos, -ARENA_HALF);
+        bottom.type = InstanceType::Boundary;
+        bottom.setColor(0.2f, 0.3f, 0.5f);
+        bottom.setScale(boundaryScale);
+        m_staticInstances.push_back(bottom);
         
         // Left edge
         InstanceData left{};
-        left.offsetX = -ARENA_HALF;
-        left.offsetY = pos;
-        left.colorR = 0.2f; left.colorG = 0.3f + pulse * 0.2f; left.colorB = 0.5f;
-        left.scale = boundaryScale;
-        m_instances.push_back(left);
+        left.setPosition(-ARENA_HALF, pos);
+        left.type = InstanceType::Boundary;
+        left.setColor(0.2f, 0.3f, 0.5f);
+        left.setScale(boundaryScale);
+        m_staticInstances.push_back(left);
         
         // Right edge
         InstanceData right{};
-        right.offsetX = ARENA_HALF;
-        right.offsetY = pos;
-        right.colorR = 0.2f; right.colorG = 0.3f + pulse * 0.2f; right.colorB = 0.5f;
-        right.scale = boundaryScale;
-        m_instances.push_back(right);
+        right.setPosition(ARENA_HALF, pos);
+        right.type = InstanceType::Boundary;
+        right.setColor(0.2f, 0.3f, 0.5f);
+        right.setScale(boundaryScale);
+        m_staticInstances.push_back(right);
     }
 }
 
@@ -463,32 +683,68 @@ void Game::addShockwaveInstances() {
         float angle = (float)i / (float)segments * 6.28318f;
         
         InstanceData wave{};
-        wave.offsetX = m_hero.x + std::cos(angle) * radius;
-        wave.offsetY = m_hero.y + std::sin(angle) * radius;
-        wave.colorR = 0.5f + alpha * 0.5f;
-        wave.colorG = 0.8f + alpha * 0.2f;
-        wave.colorB = 1.0f;
-        wave.scale = 0.2f * alpha;
-        m_instances.push_back(wave);
+        wave.setPosition(m_hero.x + std::cos(angle) * radius, m_hero.y + std::sin(angle) * radius);
+        wave.setColor(0.5f + alpha * 0.5f, 0.8f + alpha * 0.2f, 1.0f);
+        wave.setScale(0.2f * alpha);
+        m_effectInstances.push_back(wave);
     }
 }
 
-void Game::rebuildInstances() {
-    m_instances.clear();
+void Game::rebuildInstances(JobSystem* jobs) {
+    countAliveChunks(jobs);
+    buildEffectInstances();
+    writeInstances(jobs);
+}
+
+// Counts survivors per chunk so each chunk knows where its instances start
+void Game::countAliveChunks(JobSystem* jobs) {
+    size_t blockCount = m_enemies.blockCount();
+    size_t chunkCount = (blockCount + INSTANCE_CHUNK_BLOCKS - 1) / INSTANCE_CHUNK_BLOCKS;
+    m_chunkOffsets.resize(chunkCount);
+    
+    forEachRange(jobs, chunkCount, 1, [this, blockCount](size_t first, size_t last) {
+        for (size_t c = first; c < last; ++c) {
+            size_t end = std::min((c + 1) * INSTANCE_CHUNK_BLOCKS, blockCount);
+            m_chunkOffsets[c] = m_enemies.aliveCount(c * INSTANCE_CHUNK_BLOCKS, end);
+        }
+    });
     
     uint32_t aliveCount = 0;
-    for (const auto& e : m_enemies) {
-        if (e.alive) aliveCount++;
+    for (uint32_t& offset : m_chunkOffsets) {
+        uint32_t alive = offset;
+        offset = aliveCount;
+        aliveCount += alive;
     }
-    
-    // Reserve space: boundary + shockwave + hero + enemies
-    m_instances.reserve(200 + 24 + 1 + aliveCount);
-    
-    // Add arena boundary first (drawn behind everything)
-    addArenaBoundaryInstances();
+    m_aliveCount = aliveCount;
+}
+
+void Game::buildEffectInstances() {
+    m_effectInstances.clear();
     
     // Add shockwave effect
     addShockwaveInstances();
+    
+    // Effects are rebuilt every tick and drawn where they are
+    for (InstanceData& effect : m_effectInstances) {
+        effect.prevX = effect.offsetX;
+        effect.prevY = effect.offsetY;
+    }
+}
+
+void Game::writeInstances(JobSystem* jobs) {
+    size_t blockCount = m_enemies.blockCount();
+    size_t chunkCount = m_chunkOffsets.size();
+    uint32_t aliveCount = m_aliveCount;
+    
+    // Shockwave, hero, then enemies
+    uint32_t effectCount = (uint32_t)std::min<size_t>(m_effectInstances.size(), MAX_EFFECT_INSTANCES);
+    uint32_t instanceCount = effectCount + 1 + aliveCount;
+    InstanceData* out = m_instanceTarget;
+    if (out == nullptr) {
+        m_instances.resize(instanceCount);
+        out = m_instances.data();
+    }
+    std::copy(m_effectInstances.begin(), m_effectInstances.begin() + effectCount, out);
 
     // === HERO ===
     float pulse = std::sin(m_hero.pulsePhase) * 0.5f + 0.5f;
@@ -500,91 +756,106 @@ void Game::rebuildInstances() {
     bool gameOver = m_hero.health <= 0;
     
     InstanceData hero{};
-    hero.offsetX = m_hero.x;
-    hero.offsetY = m_hero.y;
+    hero.type = InstanceType::Hero;
+    hero.setPosition(m_hero.x, m_hero.y);
+    hero.setPrevPosition(m_hero.prevX, m_hero.prevY);
     
     if (gameOver) {
         // Gray when dead
-        hero.colorR = 0.3f;
-        hero.colorG = 0.3f;
-        hero.colorB = 0.3f;
-        hero.scale = heroScale * 0.8f;
+        hero.setColor(0.3f, 0.3f, 0.3f);
+        hero.setScale(heroScale * 0.8f);
     } else if (damageFlash > 0.0f) {
-        hero.colorR = 1.0f;
-        hero.colorG = 0.2f;
-        hero.colorB = 0.2f;
-        hero.scale = heroScale;
+        hero.setColor(1.0f, 0.2f, 0.2f);
+        hero.setScale(heroScale);
     } else {
-        hero.colorR = 0.3f + pulse * 0.4f + attackFlash * 0.5f;
-        hero.colorG = 0.8f + pulse * 0.2f + attackFlash * 0.2f;
-        hero.colorB = 1.0f;
-        hero.scale = heroScale + attackFlash * 0.3f;
+        hero.setColor(0.3f + pulse * 0.4f + attackFlash * 0.5f,
+                      0.8f + pulse * 0.2f + attackFlash * 0.2f,
+                      1.0f);
+        hero.setScale(heroScale + attackFlash * 0.3f);
     }
-    m_instances.push_back(hero);
+    out[effectCount] = hero;
 
     // === ENEMIES ===
-    float heroX = m_hero.x;
-    float heroY = m_hero.y;
-    
-    for (const auto& e : m_enemies) {
-        if (!e.alive) continue;
-        
-        InstanceData inst{};
-        inst.offsetX = e.x;
-        inst.offsetY = e.y;
-        
-        float dx = e.x - heroX;
-        float dy = e.y - heroY;
-        float dist = std::sqrt(dx * dx + dy * dy);
-        float proximity = 1.0f - std::clamp(dist / 8.0f, 0.0f, 1.0f);
-        
-        // More vibrant colors, danger indication
-        inst.colorR = 0.8f + proximity * 0.2f;
-        inst.colorG = 0.25f - proximity * 0.15f;
-        inst.colorB = 0.05f + proximity * 0.1f;
-        inst.scale = 0.18f + proximity * 0.06f;
-        m_instances.push_back(inst);
-    }
+    // Position and type only; the vertex shader colours and scales enemies
+    // by their distance to the hero
+    InstanceData enemy{};
+    enemy.type = InstanceType::Enemy;
+    InstanceData* enemyInstances = out + effectCount + 1;
+    
+    forEachRange(jobs, chunkCount, 1, [=, this](size_t first, size_t last) {
+        for (size_t c = first; c < last; ++c) {
+            InstanceData* dst = enemyInstances + m_chunkOffsets[c];
+            size_t end = std::min((c + 1) * INSTANCE_CHUNK_BLOCKS, blockCount);
+            const float* ex = m_enemies.x.data();
+            const float* ey = m_enemies.y.data();
+            float* px = m_enemies.prevX.data();
+            float* py = m_enemies.prevY.data();
+            
+            for (size_t block = c * INSTANCE_CHUNK_BLOCKS; block < end; ++block) {
+                for (uint64_t bits = m_enemies.aliveMask(block); bits != 0; bits &= bits - 1) {
+                    size_t i = block * EnemyPool::BLOCK + std::countr_zero(bits);
+                    
+                    // Filled in place: building it on the stack and copying
+                    // it out stalls on the narrow stores
+                    InstanceData& inst = *dst++;
+                    inst = enemy;
+                    inst.setPosition(ex[i], ey[i]);
+                    inst.setPrevPosition(px[i], py[i]);
+                    
+                    // Nothing moves enemies between here and the next
+                    // tick, so this position is where that tick starts
+                    px[i] = ex[i];
+                    py[i] = ey[i];
+                }
+            }
+        }
+    });
 
+    m_instanceOut = out;
+    m_instanceCount = instanceCount;
     m_stats.aliveCount = aliveCount;
     m_stats.enemyCount = (uint32_t)m_enemies.size();
 }
 
-void Game::spawnEnemiesInGrid(uint32_t count) {
+// Spawn is split by block so threads never share an alive word
+void Game::spawnEnemiesInGrid(uint32_t count, JobSystem* jobs) {
     m_enemies.clear();
-    m_enemies.reserve(count);
-    
-    std::uniform_real_distribution<float> phaseDist(0.0f, 6.28318f);
-    std::uniform_real_distribution<float> speedDist(0.5f, 1.5f);
-    std::uniform_real_distribution<float> chaseSpeedDist(1.5f, 4.0f);
+    m_enemies.resize(count);
+    m_respawns.clear();
     
     uint32_t gridSize = (uint32_t)std::ceil(std::sqrt((double)count));
     float spacing = (ARENA_HALF * 2.0f - 2.0f) / (float)(gridSize);
     float startX = -ARENA_HALF + 1.0f + spacing * 0.5f;
     float startY = -ARENA_HALF + 1.0f + spacing * 0.5f;
+    uint32_t generation = m_spawnGeneration;
 
-    for (uint32_t i = 0; i < count; ++i) {
-        uint32_t col = i % gridSize;
-        uint32_t row = i / gridSize;
-        
-        Enemy e{};
-        e.baseX = startX + col * spacing;
-        e.baseY = startY + row * spacing;
-        e.x = e.baseX;
-        e.y = e.baseY;
-        e.phase = phaseDist(s_rng);
-        e.speed = speedDist(s_rng);
-        e.chaseSpeed = chaseSpeedDist(s_rng);
-        e.alive = true;
-        e.deathTimer = 0.0f;
-        
-        float distSq = e.baseX * e.baseX + e.baseY * e.baseY;
-        if (distSq < 6.0f) {
-            e.alive = false;
-            e.deathTimer = 0.5f;
+    forEachRange(jobs, m_enemies.blockCount(), 0, [=, this](size_t first, size_t last) {
+        for (uint32_t i = (uint32_t)m_enemies.blockBegin(first); i < (uint32_t)m_enemies.blockEnd(last); ++i) {
+            uint32_t col = i % gridSize;
+            uint32_t row = i / gridSize;
+            
+            float baseX = startX + col * spacing;
+            float baseY = startY + row * spacing;
+            m_enemies.baseX[i] = baseX;
+            m_enemies.baseY[i] = baseY;
+            m_enemies.x[i] = baseX;
+            m_enemies.y[i] = baseY;
+            m_enemies.prevX[i] = baseX;
+            m_enemies.prevY[i] = baseY;
+            m_enemies.phase[i] = s_spawnRng.uniform(CounterRng::counter(i, generation, 0), 0.0f, 6.28318f);
+            m_enemies.speed[i] = s_spawnRng.uniform(CounterRng::counter(i, generation, 1), 0.5f, 1.5f);
+            m_enemies.chaseSpeed[i] = s_spawnRng.uniform(CounterRng::counter(i, generation, 2), 1.5f, 4.0f);
+            
+            // Keep the hero's spawn area clear for a moment
+            float distSq = baseX * baseX + baseY * baseY;
+            m_enemies.setAlive(i, distSq >= 6.0f);
+        }
+    });
+    
+    for (size_t block = 0; block < m_enemies.blockCount(); ++block) {
+        for (uint64_t bits = m_enemies.deadMask(block); bits != 0; bits &= bits - 1) {
+            m_respawns.push((uint32_t)(block * EnemyPool::BLOCK + std::countr_zero(bits)), 0.5f);
         }
-        
-        m_enemies.push_back(e);
     }
 }
 
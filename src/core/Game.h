@@ -1,22 +1,73 @@
 #pragma once
+#include "core/TaskGraph.h"
+#include "core/Task.h"
+#include "core/ParallelGovernor.h"
+#include "core/EnemyPool.h"
+#include "core/EnemyKernels.h"
+#include "core/SpatialGrid.h"
+#include "core/FlowField.h"
+#include "core/RespawnQueue.h"
+#include <algorithm>
+#include <span>
 #include <vector>
 #include <cstdint>
 #include <chrono>
+#include <atomic>
 
 namespace Legionfall {
 
 class JobSystem;
 
-// Per-instance GPU data
+// What an instance is; must match the TYPE_ constants in shaders/instanced.vert
+enum class InstanceType : uint16_t {
+    Effect,
+    Hero,
+    Enemy,      // Coloured and scaled by the shader from its distance to the hero
+    Boundary    // Static; the shader pulses its green channel with time
+};
+
+// Per-instance GPU data, 16 bytes. Positions are 16-bit fixed point over
+// +-POSITION_RANGE, the colour is RGBA8 and the scale 16-bit fixed point
+// over [0, SCALE_RANGE]; the vertex input unpacks them to floats.
+// The renderer draws each instance at mix(prev, offset, alpha), where
+// alpha is how far the frame is between the last two simulation ticks
 struct InstanceData {
-    float offsetX, offsetY;
-    float colorR, colorG, colorB;
-    float scale;
-    float padding[2];
+    int16_t offsetX, offsetY;
+    int16_t prevX, prevY;
+    uint8_t colorR, colorG, colorB, colorA;   // Unused for enemies
+    uint16_t scale;                           // Unused for enemies
+    InstanceType type;
+    
+    // Must match the constants in shaders/instanced.vert
+    static constexpr float POSITION_RANGE = 32.0f;
+    static constexpr float SCALE_RANGE = 4.0f;
+    
+    // Rounded by biasing into positive range and truncating: lround is a
+    // library call and a sign test mispredicts on every other enemy.
+    // std::clamp compiles to branches here, min/max to minss/maxss
+    static int16_t packPosition(float v) {
+        float s = std::min(std::max(v * (1.0f / POSITION_RANGE), -1.0f), 1.0f) * 32767.0f;
+        return (int16_t)((int32_t)(s + 32768.5f) - 32768);
+    }
+    static uint8_t packUnorm8(float v) { return (uint8_t)(std::min(std::max(v, 0.0f), 1.0f) * 255.0f + 0.5f); }
+    
+    void setPosition(float x, float y) { offsetX = packPosition(x); offsetY = packPosition(y); }
+    void setPrevPosition(float x, float y) { prevX = packPosition(x); prevY = packPosition(y); }
+    void setColor(float r, float g, float b) {
+        colorR = packUnorm8(r);
+        colorG = packUnorm8(g);
+        colorB = packUnorm8(b);
+        colorA = 255;
+    }
+    void setScale(float s) {
+        scale = (uint16_t)(std::min(std::max(s * (1.0f / SCALE_RANGE), 0.0f), 1.0f) * 65535.0f + 0.5f);
+    }
 };
+static_assert(sizeof(InstanceData) == 16, "InstanceData must stay 16 bytes");
 
 struct Hero {
     float x = 0.0f, y = 0.0f;
+    float prevX = 0.0f, prevY = 0.0f;  // Position at the start of the tick
     float velX = 0.0f, velY = 0.0f;
     float speed = 8.0f;
     float radius = 0.35f;
@@ -42,17 +93,6 @@ struct Hero {
     float damageFlash = 0.0f;
 };
 
-struct Enemy {
-    float x, y;
-    float baseX, baseY;
-    float phase;
-    float speed;
-    float chaseSpeed;
-    bool alive;
-    float deathTimer;
-    float deathX, deathY;
-};
-
 struct InputState {
     bool moveUp = false, moveDown = false;
     bool moveLeft = false, moveRight = false;
@@ -81,42 +121,134 @@ struct ProfilingStats {
     bool chaseModeEnabled = true;
     float heroX = 0.0f, heroY = 0.0f;
     size_t threadCount = 0;
+    
+    // JobSystem configuration in use
+    size_t workerCount = 0;
+    size_t backgroundWorkers = 0;
+    bool workersPinned = false;
+    uint32_t spinMicros = 0;
+    uint32_t yieldMicros = 0;
+    
+    // Shapes the governors picked for the movement and separation passes
+    GovernorStats moveGovernor;
+    GovernorStats separateGovernor;
+    
+    // Times the flow field was recomputed, i.e. the hero changed cells
+    uint32_t flowFieldUpdates = 0;
+    
+    // Instruction set of the enemy movement kernel
+    const char* simdKernel = "scalar";
 };
 
 class Game {
 public:
-    void init(uint32_t enemyCount);
+    ~Game();
+    
+    void init(uint32_t enemyCount, JobSystem* jobs = nullptr);
     void update(float dt, const InputState& input, JobSystem* jobs);
-    void restart();
-    void adjustEnemyCount(int delta);
+    void restart(JobSystem* jobs = nullptr);
+    void adjustEnemyCount(int delta, JobSystem* jobs = nullptr);
+    
+    // Defaults to the best level the CPU supports; lower it to compare kernels
+    void setSimdLevel(SimdLevel level);
+    
+    // Instances from the last update, written straight into the current
+    // target if one is set and into an internal list otherwise
+    std::span<const InstanceData> getInstanceData() const { return {m_instanceOut, m_instanceCount}; }
+    
+    // Where the next update writes its instances, e.g. mapped GPU memory. The
+    // target must hold maxInstanceCount() instances; null means the internal list.
+    void setInstanceTarget(InstanceData* target) { m_instanceTarget = target; }
+    static constexpr uint32_t maxInstanceCount() { return MAX_EFFECT_INSTANCES + 1 + MAX_ENEMIES; }
+    
+    // Instances that never move: the arena boundary, and any obstacles or
+    // decals added later. Built by the first init() and unchanged after, so
+    // the renderer uploads them once and draws them apart from getInstanceData().
+    const std::vector<InstanceData>& getStaticInstances() const { return m_staticInstances; }
     
-    const std::vector<InstanceData>& getInstanceData() const { return m_instances; }
     const ProfilingStats& getStats() const { return m_stats; }
-    void getHeroPosition(float& x, float& y) const { x = m_hero.x; y = m_hero.y; }
+    // alpha blends from the previous tick's position (0) to the current one (1)
+    void getHeroPosition(float& x, float& y, float alpha = 1.0f) const {
+        x = m_hero.prevX + (m_hero.x - m_hero.prevX) * alpha;
+        y = m_hero.prevY + (m_hero.y - m_hero.prevY) * alpha;
+    }
     bool isCameraFollowEnabled() const { return m_cameraFollowEnabled; }
     float getShockwaveRadius() const { return m_hero.shockwaveRadius; }
     float getShockwaveAlpha() const { return m_hero.shockwaveAlpha; }
     bool isGameOver() const { return m_hero.health <= 0; }
+    float getTime() const { return m_time; }
 
 private:
-    void updateHero(float dt, const InputState& input);
-    void performAttack();
+    void buildFrameGraph();
+    void updateHero(float dt, const InputState& input, JobSystem* jobs);
+    void performAttack(JobSystem* jobs);
     void updateEnemiesSingleThreaded(float dt);
     void updateEnemiesParallel(float dt, JobSystem* jobs);
-    void checkCollisions();
-    void respawnEnemy(Enemy& e);
-    void rebuildInstances();
-    void spawnEnemiesInGrid(uint32_t count);
+    void updateEnemyBlocks(size_t firstBlock, size_t lastBlock, float dt);
+    void stageRespawns(float dt, JobSystem* jobs);
+    void reviveStagedEnemies();
+    void buildGrid(JobSystem* jobs);
+    void separateEnemies(float dt, JobSystem* jobs);
+    void separateEntries(uint32_t firstSlot, uint32_t lastSlot, float dt);
+    void checkCollisions(JobSystem* jobs);
+    void respawnEnemy(uint32_t i);
+    void rebuildInstances(JobSystem* jobs);
+    void countAliveChunks(JobSystem* jobs);
+    void buildEffectInstances();
+    void writeInstances(JobSystem* jobs);
+    void spawnEnemiesInGrid(uint32_t count, JobSystem* jobs);
+    void buildStaticInstances();
     void addArenaBoundaryInstances();
     void addShockwaveInstances();
-    float doHeavyWork(float x, float y);
+    static float doHeavyWork(float x, float y);
+    void stopBackgroundWork();
+    Task<void> resortEnemiesLoop(JobSystem& jobs);
 
     Hero m_hero;
-    std::vector<Enemy> m_enemies;
+    EnemyPool m_enemies;
+    SpatialGrid m_grid;
+    FlowField m_flowField;
     std::vector<InstanceData> m_instances;
+    InstanceData* m_instanceTarget = nullptr;
+    InstanceData* m_instanceOut = nullptr;
+    uint32_t m_instanceCount = 0;
+    std::vector<InstanceData> m_effectInstances;
+    std::vector<InstanceData> m_staticInstances;
+    std::vector<uint32_t> m_chunkOffsets;
+    
+    // Dead enemies by respawn time, and those coming back this frame
+    RespawnQueue m_respawns;
+    std::vector<uint32_t> m_stagedRespawns;
+    
+    // Attack and contact queries: grid runs, a result count per run, and
+    // the attack's kills stored at each run's first slot onwards
+    std::vector<SpatialGrid::SlotRun> m_queryRuns;
+    std::vector<uint32_t> m_runCounts;
+    std::vector<uint32_t> m_runKills;
+    uint32_t m_aliveCount = 0;
     ProfilingStats m_stats;
     
+    // Movement counts in 64-enemy blocks, separation in grid entries
+    ParallelGovernor m_moveGovernor{1};
+    ParallelGovernor m_separateGovernor{64};
+    
+    // Built once; its tasks read the current frame's inputs from the members below
+    TaskGraph m_frameGraph;
+    float m_frameDt = 0.0f;
+    const InputState* m_frameInput = nullptr;
+    JobSystem* m_frameJobs = nullptr;
+    
+    // Multi-frame coroutines sleep on m_frames; everything they resume at a
+    // frame boundary finishes before that frame's graph starts
+    FrameCounter m_frames;
+    JobCounter m_boundaryCounter;
+    JobCounter m_backgroundCounter;
+    JobSystem* m_backgroundJobs = nullptr;
+    std::atomic<bool> m_stopBackground{false};
+    uint32_t m_spawnGeneration = 0;
+    
     float m_time = 0.0f;
+    uint32_t m_frameIndex = 0;
     uint32_t m_initialEnemyCount = 5000;
     uint32_t m_targetEnemyCount = 5000;
     
@@ -125,6 +257,8 @@ private:
     bool m_heavyWorkEnabled = false;
     bool m_cameraFollowEnabled = false;
     bool m_chaseModeEnabled = true;
+    SimdLevel m_simdLevel = detectSimdLevel();
+    EnemyMoveKernel m_moveKernel = enemyMoveKernel(m_simdLevel);
     bool m_toggleParallelPressed = false;
     bool m_toggleHeavyPressed = false;
     bool m_toggleCameraPressed = false;
@@ -137,6 +271,42 @@ private:
     static constexpr float RESPAWN_DELAY = 2.0f;
     static constexpr uint32_t MIN_ENEMIES = 100;
     static constexpr uint32_t MAX_ENEMIES = 50000;
+    
+    // Attack, contact and separation go through a grid of this cell size,
+    // built after movement. Separation then moves an enemy at most
+    // SEPARATION_MAX_STEP and touching the hero pushes it CONTACT_PUSH, so
+    // queries after the build widen their radius by what can have happened.
+    static constexpr float GRID_CELL_SIZE = 1.0f;
+    
+    // Chasing enemies steer by a flow field with cells of this size
+    static constexpr float FLOW_CELL_SIZE = 0.5f;
+    static constexpr float CONTACT_PUSH = 0.5f;
+    
+    // Grid entries per job in the attack and contact queries
+    static constexpr uint32_t QUERY_RUN = 1024;
+    
+    // Enemies closer than SEPARATION_RADIUS push each other apart. Each one
+    // looks at no more than SEPARATION_CANDIDATES grid entries and takes at
+    // most SEPARATION_NEIGHBOURS of them, so dense crowds cost the same per
+    // enemy as sparse ones.
+    static constexpr float SEPARATION_RADIUS = 0.25f;
+    static constexpr float SEPARATION_SPEED = 2.0f;
+    static constexpr float SEPARATION_MAX_STEP = 0.05f;
+    static constexpr uint32_t SEPARATION_NEIGHBOURS = 8;
+    static constexpr uint32_t SEPARATION_CANDIDATES = 32;
+    
+    // Per-tick effect instances (shockwave segments) beyond this many are not drawn
+    static constexpr uint32_t MAX_EFFECT_INSTANCES = 256;
+    
+    // Enemies per chunk when compacting survivors into the instance list
+    static constexpr size_t INSTANCE_CHUNK = 4096;
+    static constexpr size_t INSTANCE_CHUNK_BLOCKS = INSTANCE_CHUNK / EnemyPool::BLOCK;
+    
+    // Enemies are re-sorted by grid cell this often so neighbours stay close
+    // in memory; each new order lands a fixed delay after its keys were taken
+    static constexpr uint64_t RESORT_INTERVAL_FRAMES = 120;
+    static constexpr uint64_t RESORT_APPLY_DELAY_FRAMES = 4;
+    static constexpr float RESORT_CELL_SIZE = 1.0f;
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace Legionfall {
+
+class JobPool;
+struct Job;
+
+// Frame jobs are always taken before background ones. Background jobs run
+// on a capped number of workers and yield to frame work between chunks.
+enum class JobPriority : uint8_t {
+    Frame,
+    Background
+};
+
+// Tracks a group of jobs; reaches zero when all of them have finished.
+// An optional continuation job is scheduled at that point.
+struct JobCounter {
+    std::atomic<int> pending{0};
+    Job* continuation = nullptr;
+};
+
+// A unit of work with inline storage for its callable. Jobs are recycled
+// through per-thread pools, so scheduling never touches the allocator once
+// the pools are warm. Captures that don't fit are rejected at compile time.
+struct alignas(64) Job {
+    static constexpr size_t STORAGE_SIZE = 80;
+
+    template <typename Fn>
+    void bind(Fn&& fn) {
+        using F = std::decay_t<Fn>;
+        static_assert(sizeof(F) <= STORAGE_SIZE,
+            "Job callable is too large for inline storage; capture a pointer to shared state instead");
+        static_assert(alignof(F) <= alignof(std::max_align_t), "Job callable is over-aligned");
+        
+        new (storage) F(std::forward<Fn>(fn));
+        invoke = [](void* p) {
+            F& f = *static_cast<F*>(p);
+            f();
+            f.~F();
+        };
+    }
+
+    void run() { invoke(storage); }
+
+    void (*invoke)(void*) = nullptr;
+    JobCounter* counter = nullptr;
+    JobPool* pool = nullptr;
+    Job* next = nullptr;
+    const char* label = nullptr;
+    JobPriority priority = JobPriority::Frame;
+    alignas(std::max_align_t) unsigned char storage[STORAGE_SIZE];
+};
+
+static_assert(sizeof(Job) == 128, "Job should span exactly two cache lines");
+
+}
\ No newline at end of file
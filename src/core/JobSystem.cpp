@@ -2,24 +2,146 @@
 #include <algorithm>
 #include <iostream>
 
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
 namespace Legionfall {
 
-JobSystem::JobSystem() {
-    // Use fewer threads to avoid overhead - max 8 or hardware - 1
-    size_t numThreads = std::min(8u, std::max(1u, std::thread::hardware_concurrency() - 1));
+namespace {
+    constexpr size_t DEQUE_CAPACITY = 4096;
+    constexpr size_t INJECTION_CAPACITY = 4096;
+    constexpr size_t NO_WORKER = SIZE_MAX;
+    constexpr size_t MIN_AUTO_GRAIN = 64;
+    constexpr size_t AUTO_CHUNKS_PER_THREAD = 8;
+    constexpr size_t JOB_POOL_BLOCK = 512;
+
+    // Identifies the worker (if any) running on the current thread
+    thread_local JobSystem* t_jobSystem = nullptr;
+    thread_local size_t t_workerIndex = 0;
+    
+    // The pool this thread allocates jobs from
+    thread_local JobSystem* t_poolOwner = nullptr;
+    thread_local JobPool* t_jobPool = nullptr;
     
-    std::cout << "JobSystem: starting with " << numThreads << " worker threads" << std::endl;
+    // Priority of the job running on this thread; new jobs inherit it
+    thread_local JobPriority t_priority = JobPriority::Frame;
+    
+    using Clock = std::chrono::steady_clock;
+    
+    void cpuRelax() {
+#if defined(_M_X64) || defined(__x86_64__)
+        _mm_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
+    
+    void pinCurrentThread(size_t core) {
+#if defined(_WIN32)
+        SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << (core % (sizeof(DWORD_PTR) * 8)));
+#elif defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core % CPU_SETSIZE, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+        (void)core;
+#endif
+    }
+}
+
+// Free list of jobs owned by one thread. The owner allocates and recycles
+// without atomics; jobs finished on other threads come back through a
+// lock-free stack that the owner drains in one exchange when it runs dry.
+class JobPool {
+public:
+    explicit JobPool(size_t initialSize) { grow(initialSize); }
+    
+    Job* allocate() {
+        if (!m_free) m_free = m_remoteFree.exchange(nullptr, std::memory_order_acquire);
+        if (!m_free) grow(JOB_POOL_BLOCK);
+        
+        Job* job = m_free;
+        m_free = job->next;
+        return job;
+    }
+    
+    void releaseLocal(Job* job) {
+        job->next = m_free;
+        m_free = job;
+    }
+    
+    void releaseRemote(Job* job) {
+        Job* head = m_remoteFree.load(std::memory_order_relaxed);
+        do {
+            job->next = head;
+        } while (!m_remoteFree.compare_exchange_weak(head, job, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+private:
+    void grow(size_t count) {
+        auto block = std::make_unique<Job[]>(count);
+        for (size_t i = 0; i < count; ++i) {
+            block[i].pool = this;
+            releaseLocal(&block[i]);
+        }
+        m_blocks.push_back(std::move(block));
+    }
+    
+    Job* m_free = nullptr;
+    alignas(64) std::atomic<Job*> m_remoteFree{nullptr};
+    std::vector<std::unique_ptr<Job[]>> m_blocks;
+};
+
+JobSystem::JobSystem(const JobSystemConfig& config)
+    : m_config(config), m_trace(config.traceCapacity),
+      m_injectionQueue(INJECTION_CAPACITY), m_backgroundQueue(INJECTION_CAPACITY) {
+    // Default to hardware - 1; the calling thread fills the last core from inside wait()
+    size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    if (m_config.workerCount == 0) m_config.workerCount = std::max<size_t>(1, cores - 1);
+    size_t numThreads = m_config.workerCount;
+    
+    // Background work may use half the pool, so frame work always finds a free worker
+    if (m_config.backgroundWorkers == 0) m_config.backgroundWorkers = std::max<size_t>(1, numThreads / 2);
+    m_config.backgroundWorkers = std::min(m_config.backgroundWorkers, numThreads);
+    m_backgroundLimit.store((int)m_config.backgroundWorkers, std::memory_order_relaxed);
+    
+    std::cout << "JobSystem: starting with " << numThreads << " worker threads"
+              << (m_config.pinWorkers ? " (pinned)" : "")
+              << ", spin " << m_config.spinMicros << "us, yield " << m_config.yieldMicros << "us" << std::endl;
+    
+    // All deques must exist before any worker starts stealing
+    m_deques.reserve(numThreads);
+    m_workerPools.reserve(numThreads);
+    for (size_t i = 0; i < numThreads; ++i) {
+        m_deques.push_back(std::make_unique<WorkStealingDeque>(DEQUE_CAPACITY));
+        m_workerPools.push_back(std::make_unique<JobPool>(JOB_POOL_BLOCK));
+    }
     
     m_workers.reserve(numThreads);
     for (size_t i = 0; i < numThreads; ++i) {
-        m_workers.emplace_back(&JobSystem::workerLoop, this);
+        m_workers.emplace_back(&JobSystem::workerLoop, this, i);
     }
 }
 
 JobSystem::~JobSystem() {
     // Signal shutdown
-    m_shutdown = true;
-    m_taskAvailable.notify_all();
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_shutdown = true;
+        m_wakeEpoch.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_wakeCondition.notify_all();
     
     // Join all workers
     for (auto& worker : m_workers) {
@@ -29,55 +151,291 @@ JobSystem::~JobSystem() {
     }
 }
 
-void JobSystem::schedule(std::function<void()> task) {
-    {
-        std::lock_guard<std::mutex> lock(m_queueMutex);
-        m_pendingTasks.fetch_add(1, std::memory_order_release);
-        m_tasks.push(std::move(task));
+Job* JobSystem::allocateJob() {
+    if (t_poolOwner != this) {
+        // First submission from this outside thread: give it a pool of its own
+        std::lock_guard<std::mutex> lock(m_poolMutex);
+        m_externalPools.push_back(std::make_unique<JobPool>(JOB_POOL_BLOCK));
+        t_jobPool = m_externalPools.back().get();
+        t_poolOwner = this;
     }
-    m_taskAvailable.notify_one();
+    return t_jobPool->allocate();
+}
+
+JobPriority JobSystem::currentPriority() {
+    return t_priority;
+}
+
+void JobSystem::setBackgroundWorkerLimit(size_t limit) {
+    limit = std::clamp<size_t>(limit, 1, std::max<size_t>(1, m_workers.size()));
+    m_config.backgroundWorkers = limit;
+    m_backgroundLimit.store((int)limit, std::memory_order_relaxed);
+    wakeWorker();
+}
+
+bool JobSystem::shouldYield() const {
+    return t_priority == JobPriority::Background && hasQueuedJobs() && !hasIdleWorkers();
+}
+
+void JobSystem::submit(Job* job) {
+    if (job->counter) {
+        job->counter->pending.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    bool queued = false;
+    if (job->priority == JobPriority::Background) {
+        queued = m_backgroundQueue.push(job);
+    } else if (t_jobSystem == this) {
+        queued = m_deques[t_workerIndex]->push(job);
+    }
+    if (!queued && job->priority == JobPriority::Frame) {
+        queued = m_injectionQueue.push(job);
+    }
+    if (!queued) {
+        // Every queue is saturated: run it here rather than block
+        if (job->priority == JobPriority::Background && t_priority == JobPriority::Frame) {
+            m_activeBackground.fetch_add(1, std::memory_order_acquire);
+        }
+        execute(job);
+        return;
+    }
+    
+    wakeWorker();
 }
 
 void JobSystem::wait() {
-    std::unique_lock<std::mutex> lock(m_waitMutex);
-    m_taskComplete.wait(lock, [this] {
-        return m_pendingTasks.load(std::memory_order_acquire) == 0;
-    });
+    wait(m_defaultCounter);
 }
 
-void JobSystem::workerLoop() {
-    while (true) {
-        std::function<void()> task;
+void JobSystem::wait(JobCounter& counter) {
+    // The waiting thread runs queued jobs itself instead of idling a core.
+    // It only picks up background work if it is already inside some, so a
+    // frame never waits behind a long background job.
+    size_t index = (t_jobSystem == this) ? t_workerIndex : NO_WORKER;
+    bool allowBackground = t_priority == JobPriority::Background;
+    uint32_t rng = (uint32_t)(uintptr_t)&counter | 1u;
+    bool idle = false;
+    Clock::time_point idleSince;
+    
+    while (counter.pending.load(std::memory_order_acquire) > 0) {
+        if (Job* job = findJob(index, rng, allowBackground)) {
+            execute(job);
+            idle = false;
+            continue;
+        }
+        
+        // Nothing left to run: the last jobs are in flight on other threads
+        if (!idle) {
+            idle = true;
+            idleSince = Clock::now();
+        }
+        if (backOff(idleSince)) continue;
         
+        uint64_t beginNs = m_trace.enabled() ? m_trace.now() : 0;
         {
-            std::unique_lock<std::mutex> lock(m_queueMutex);
-            m_taskAvailable.wait(lock, [this] {
-                return m_shutdown.load(std::memory_order_acquire) || !m_tasks.empty();
+            std::unique_lock<std::mutex> lock(m_waitMutex);
+            m_taskComplete.wait(lock, [&counter] {
+                return counter.pending.load(std::memory_order_acquire) == 0;
             });
-            
-            if (m_shutdown.load(std::memory_order_acquire) && m_tasks.empty()) {
-                return;
-            }
-            
-            if (m_tasks.empty()) {
-                continue;
-            }
-            
-            task = std::move(m_tasks.front());
-            m_tasks.pop();
+        }
+        if (m_trace.enabled()) m_trace.record("blocked", beginNs, m_trace.now());
+    }
+}
+
+size_t JobSystem::autoGrain(size_t count) const {
+    size_t chunks = (m_workers.size() + 1) * AUTO_CHUNKS_PER_THREAD;
+    return std::max(MIN_AUTO_GRAIN, count / chunks);
+}
+
+void JobSystem::workerLoop(size_t index) {
+    t_jobSystem = this;
+    t_workerIndex = index;
+    t_poolOwner = this;
+    t_jobPool = m_workerPools[index].get();
+    uint32_t rng = (uint32_t)index * 0x9E3779B9u + 1u;
+    bool idle = false;
+    Clock::time_point idleSince;
+    
+    m_trace.nameThread("Worker " + std::to_string(index));
+    
+    if (m_config.pinWorkers) {
+        pinCurrentThread((index + 1) % std::max(1u, std::thread::hardware_concurrency()));
+    }
+    
+    while (true) {
+        Job* job = findJob(index, rng, true);
+        if (job) {
+            if (idle) m_idleWorkers.fetch_sub(1, std::memory_order_relaxed);
+            execute(job);
+            idle = false;
+            continue;
         }
         
-        // Execute task outside lock
-        if (task) {
-            task();
+        if (m_shutdown.load(std::memory_order_acquire)) {
+            return;
         }
         
-        // Signal completion
-        int remaining = m_pendingTasks.fetch_sub(1, std::memory_order_release) - 1;
-        if (remaining == 0) {
-            m_taskComplete.notify_all();
+        // Advertise hunger so running parallelFor ranges split work off for us
+        if (!idle) {
+            m_idleWorkers.fetch_add(1, std::memory_order_relaxed);
+            idle = true;
+            idleSince = Clock::now();
         }
+        
+        // Stay hot briefly so back-to-back frames don't pay a wakeup
+        if (backOff(idleSince)) continue;
+        
+        sleepWorker();
+        idleSince = Clock::now();
+    }
+}
+
+// One idle round: spin, then yield, then return false once it is time to sleep
+bool JobSystem::backOff(Clock::time_point idleSince) const {
+    auto idleMicros = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - idleSince).count();
+    if (idleMicros < m_config.spinMicros) {
+        for (int i = 0; i < 16; ++i) cpuRelax();
+        return true;
+    }
+    if (idleMicros < (long long)m_config.spinMicros + m_config.yieldMicros) {
+        std::this_thread::yield();
+        return true;
+    }
+    return false;
+}
+
+Job* JobSystem::findJob(size_t index, uint32_t& rng, bool allowBackground) {
+    if (index != NO_WORKER) {
+        if (Job* job = m_deques[index]->pop()) return job;
+    }
+    if (Job* job = m_injectionQueue.pop()) return job;
+    
+    // Steal, starting from a random victim to spread contention
+    size_t count = m_deques.size();
+    rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+    size_t start = rng % count;
+    for (size_t i = 0; i < count; ++i) {
+        size_t victim = (start + i) % count;
+        if (victim == index) continue;
+        if (Job* job = m_deques[victim]->steal()) return job;
+    }
+    return allowBackground ? takeBackgroundJob() : nullptr;
+}
+
+Job* JobSystem::takeBackgroundJob() {
+    // Nested background jobs run under the slot their parent already holds
+    if (t_priority == JobPriority::Background) return m_backgroundQueue.pop();
+    
+    int limit = m_backgroundLimit.load(std::memory_order_relaxed);
+    if (m_activeBackground.fetch_add(1, std::memory_order_acquire) >= limit) {
+        m_activeBackground.fetch_sub(1, std::memory_order_release);
+        return nullptr;
+    }
+    
+    Job* job = m_backgroundQueue.pop();
+    if (!job) m_activeBackground.fetch_sub(1, std::memory_order_release);
+    return job;
+}
+
+bool JobSystem::hasQueuedJobs() const {
+    if (!m_injectionQueue.empty()) return true;
+    for (const auto& deque : m_deques) {
+        if (!deque->empty()) return true;
+    }
+    return false;
+}
+
+bool JobSystem::hasRunnableBackgroundJobs() const {
+    return !m_backgroundQueue.empty() &&
+           m_activeBackground.load(std::memory_order_relaxed) < m_backgroundLimit.load(std::memory_order_relaxed);
+}
+
+void JobSystem::execute(Job* job) {
+    JobPriority outer = t_priority;
+    const char* outerLabel = JobTrace::currentLabel();
+    t_priority = job->priority;
+    JobTrace::setCurrentLabel(job->label);
+    
+    if (m_trace.enabled()) {
+        uint64_t beginNs = m_trace.now();
+        job->run();
+        m_trace.record(job->label, beginNs, m_trace.now());
+    } else {
+        job->run();
     }
+    
+    t_priority = outer;
+    JobTrace::setCurrentLabel(outerLabel);
+    
+    // A top-level background job gives its slot back; let another take it
+    if (job->priority == JobPriority::Background && outer == JobPriority::Frame) {
+        m_activeBackground.fetch_sub(1, std::memory_order_release);
+        if (!m_backgroundQueue.empty()) wakeWorker();
+    }
+    
+    JobCounter* counter = job->counter;
+    
+    if (t_poolOwner == this && job->pool == t_jobPool) {
+        t_jobPool->releaseLocal(job);
+    } else {
+        job->pool->releaseRemote(job);
+    }
+    
+    if (counter) {
+        finish(counter);
+    }
+}
+
+void JobSystem::signal(JobCounter& counter) {
+    finish(&counter);
+}
+
+void JobSystem::finish(JobCounter* counter) {
+    // Grab the continuation first: once it runs, the counter may be gone
+    Job* continuation = counter->continuation;
+    int remaining = counter->pending.fetch_sub(1, std::memory_order_acq_rel) - 1;
+    if (remaining != 0) return;
+    
+    if (continuation) {
+        counter->continuation = nullptr;
+        submit(continuation);
+    }
+    
+    std::lock_guard<std::mutex> lock(m_waitMutex);
+    m_taskComplete.notify_all();
+}
+
+void JobSystem::wakeWorker() {
+    // Pairs with the fence in sleepWorker: either we see the sleeper, or it sees our job
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_sleepingWorkers.load(std::memory_order_relaxed) == 0) return;
+    
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_wakeEpoch.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_wakeCondition.notify_one();
+}
+
+void JobSystem::sleepWorker() {
+    uint64_t epoch = m_wakeEpoch.load(std::memory_order_acquire);
+    m_sleepingWorkers.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    
+    // Re-check after announcing ourselves so a concurrent schedule() can't be missed
+    if (!hasQueuedJobs() && !hasRunnableBackgroundJobs()) {
+        uint64_t beginNs = m_trace.enabled() ? m_trace.now() : 0;
+        {
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_wakeCondition.wait(lock, [this, epoch] {
+                return m_shutdown.load(std::memory_order_relaxed) ||
+                       m_wakeEpoch.load(std::memory_order_relaxed) != epoch;
+            });
+        }
+        if (m_trace.enabled()) m_trace.record("sleep", beginNs, m_trace.now());
+    }
+    
+    m_sleepingWorkers.fetch_sub(1, std::memory_order_relaxed);
 }
 
 }
\ No newline at end of file
@@ -1,37 +1,332 @@
 #pragma once
-#include <functional>
+#include "core/Job.h"
+#include "core/JobQueues.h"
+#include "core/JobTrace.h"
+#include <array>
 #include <vector>
-#include <queue>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include <memory>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
 
 namespace Legionfall {
 
+// How a parallel loop is cut up: chunks of at least `grain` elements
+// (0 = automatic) worked on by at most `maxThreads` threads at once,
+// counting the caller (0 = no limit, 1 = run inline).
+struct ParallelShape {
+    size_t grain = 0;
+    size_t maxThreads = 0;
+};
+
+// Worker topology and idle behaviour. Zero means "pick a default"; the
+// resolved values can be read back from JobSystem::config().
+struct JobSystemConfig {
+    size_t workerCount = 0;            // default: one per core, minus the main thread's
+    size_t backgroundWorkers = 0;      // default: half the workers
+    bool pinWorkers = false;           // pin worker i to core i + 1, leaving core 0 to the main thread
+    
+    // An idle thread busy-spins, then yields its timeslice, then sleeps
+    uint32_t spinMicros = 50;
+    uint32_t yieldMicros = 250;
+    
+    // Spans kept per thread for JobSystem::trace(); 0 disables tracing
+    size_t traceCapacity = 16384;
+};
+
+// Work-stealing scheduler. Each worker owns a Chase-Lev deque; jobs
+// scheduled from a worker go to its own deque, jobs scheduled from any
+// other thread go through a shared lock-free injection queue. Idle
+// workers steal from their peers before going to sleep.
+// Background jobs sit in a queue of their own that workers only look at
+// once there is no frame work left, and never on more than
+// backgroundWorkerLimit() workers at a time.
 class JobSystem {
 public:
-    JobSystem();
+    explicit JobSystem(const JobSystemConfig& config = {});
     ~JobSystem();
     
-    void schedule(std::function<void()> task);
+    // fn must be callable as fn() and fit in Job::STORAGE_SIZE bytes.
+    // Without an explicit priority, jobs inherit that of the job scheduling
+    // them; anything scheduled from outside a job is frame work.
+    template <typename Fn>
+    void schedule(Fn&& fn);
+    template <typename Fn>
+    void schedule(Fn&& fn, JobCounter& counter);
+    template <typename Fn>
+    void schedule(Fn&& fn, JobCounter& counter, JobPriority priority);
+    
+    // Runs fn without tracking it on any counter; wait() won't see it
+    template <typename Fn>
+    void scheduleDetached(Fn&& fn);
+    template <typename Fn>
+    void scheduleDetached(Fn&& fn, JobPriority priority);
+    
+    // Schedules fn once counter drains. Set it before any work is scheduled
+    // on the counter, holding the counter open with an extra pending unit
+    // that is released with signal() afterwards.
+    template <typename Fn>
+    void continueWith(JobCounter& counter, Fn&& fn);
+    
+    // Completes one unit of the counter's pending work
+    void signal(JobCounter& counter);
+    
+    // Runs pending jobs on the calling thread until the counter drains,
+    // then spins briefly and finally blocks for the stragglers.
     void wait();
+    void wait(JobCounter& counter);
+    
     size_t threadCount() const { return m_workers.size(); }
+    const JobSystemConfig& config() const { return m_config; }
+    
+    // Every job is recorded here with the label that was current when it was
+    // scheduled (see TraceSpan), along with worker sleeps
+    JobTrace& trace() { return m_trace; }
+    
+    // How many workers may run background jobs at once (at least 1)
+    void setBackgroundWorkerLimit(size_t limit);
+    size_t backgroundWorkerLimit() const { return (size_t)m_backgroundLimit.load(std::memory_order_relaxed); }
+    
+    // True inside a background job while frame work is queued and no worker
+    // is free to take it. Long background jobs should check this between
+    // chunks and reschedule their remainder; background ranges already do.
+    bool shouldYield() const;
+    
+    // Priority of the job running on the calling thread (Frame outside jobs)
+    static JobPriority currentPriority();
+    
+    // Calls fn(rangeBegin, rangeEnd) over [begin, end) and blocks until done.
+    // Ranges are split in half while workers are hungry, never below `grain`
+    // elements; grain == 0 picks one from the range size and thread count.
+    // The ParallelShape forms can also cap how many threads take part.
+    template <typename Fn>
+    void parallelFor(size_t begin, size_t end, size_t grain, Fn&& fn);
+    template <typename Fn>
+    void parallelFor(size_t begin, size_t end, ParallelShape shape, Fn&& fn);
+    
+    // fn(rangeBegin, rangeEnd) returns a partial result for each chunk of
+    // `grain` elements; the partials are folded with combine, which must be
+    // associative, in chunk order. The result depends only on the range and
+    // the grain, never on which thread ran which chunk, so a float sum is
+    // reproducible for a fixed grain (grain == 0 picks one from the pool size).
+    template <typename T, typename Fn, typename Combine>
+    T parallelReduce(size_t begin, size_t end, size_t grain, T identity, Fn&& fn, Combine&& combine);
+    template <typename T, typename Fn, typename Combine>
+    T parallelReduce(size_t begin, size_t end, ParallelShape shape, T identity, Fn&& fn, Combine&& combine);
+    
+    // Non-blocking parallelFor: the range's jobs are tracked on counter.
+    // fn is taken by reference and must outlive them.
+    template <typename Fn>
+    void scheduleRange(size_t begin, size_t end, size_t grain, Fn& fn, JobCounter& counter);
 
 private:
-    void workerLoop();
+    Job* allocateJob();
+    void submit(Job* job);
+    void finish(JobCounter* counter);
+    void workerLoop(size_t index);
+    Job* findJob(size_t index, uint32_t& rng, bool allowBackground);
+    Job* takeBackgroundJob();
+    bool hasQueuedJobs() const;
+    bool hasRunnableBackgroundJobs() const;
+    void execute(Job* job);
+    void wakeWorker();
+    void sleepWorker();
+    bool backOff(std::chrono::steady_clock::time_point idleSince) const;
+    
+    size_t autoGrain(size_t count) const;
+    bool hasIdleWorkers() const { return m_idleWorkers.load(std::memory_order_relaxed) > 0; }
+    
+    // helpers, when set, counts the extra threads a capped range may still take on
+    template <typename Fn>
+    void runRange(size_t begin, size_t end, size_t grain, int splits, Fn& fn, JobCounter& counter,
+                  std::atomic<int>* helpers = nullptr);
     
+    JobSystemConfig m_config;
+    JobTrace m_trace;
     std::vector<std::thread> m_workers;
-    std::queue<std::function<void()>> m_tasks;
+    std::vector<std::unique_ptr<WorkStealingDeque>> m_deques;
+    InjectionQueue m_injectionQueue;
+    InjectionQueue m_backgroundQueue;
+    std::atomic<int> m_activeBackground{0};
+    std::atomic<int> m_backgroundLimit{1};
     
-    std::mutex m_queueMutex;
-    std::condition_variable m_taskAvailable;
+    // One job pool per worker, plus one per outside thread that schedules work
+    std::vector<std::unique_ptr<JobPool>> m_workerPools;
+    std::vector<std::unique_ptr<JobPool>> m_externalPools;
+    std::mutex m_poolMutex;
+    
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wakeCondition;
+    std::atomic<uint64_t> m_wakeEpoch{0};
+    std::atomic<int> m_sleepingWorkers{0};
+    std::atomic<int> m_idleWorkers{0};
     
     std::mutex m_waitMutex;
     std::condition_variable m_taskComplete;
     
-    std::atomic<int> m_pendingTasks{0};
+    JobCounter m_defaultCounter;
     std::atomic<bool> m_shutdown{false};
 };
 
+template <typename Fn>
+void JobSystem::schedule(Fn&& fn) {
+    schedule(std::forward<Fn>(fn), m_defaultCounter);
+}
+
+template <typename Fn>
+void JobSystem::schedule(Fn&& fn, JobCounter& counter) {
+    schedule(std::forward<Fn>(fn), counter, currentPriority());
+}
+
+template <typename Fn>
+void JobSystem::schedule(Fn&& fn, JobCounter& counter, JobPriority priority) {
+    Job* job = allocateJob();
+    job->bind(std::forward<Fn>(fn));
+    job->counter = &counter;
+    job->label = JobTrace::currentLabel();
+    job->priority = priority;
+    submit(job);
+}
+
+template <typename Fn>
+void JobSystem::scheduleDetached(Fn&& fn) {
+    scheduleDetached(std::forward<Fn>(fn), currentPriority());
+}
+
+template <typename Fn>
+void JobSystem::scheduleDetached(Fn&& fn, JobPriority priority) {
+    Job* job = allocateJob();
+    job->bind(std::forward<Fn>(fn));
+    job->counter = nullptr;
+    job->label = JobTrace::currentLabel();
+    job->priority = priority;
+    submit(job);
+}
+
+template <typename Fn>
+void JobSystem::continueWith(JobCounter& counter, Fn&& fn) {
+    Job* job = allocateJob();
+    job->bind(std::forward<Fn>(fn));
+    job->counter = nullptr;
+    job->label = JobTrace::currentLabel();
+    job->priority = currentPriority();
+    counter.continuation = job;
+}
+
+template <typename Fn>
+void JobSystem::parallelFor(size_t begin, size_t end, size_t grain, Fn&& fn) {
+    parallelFor(begin, end, ParallelShape{grain, 0}, fn);
+}
+
+template <typename Fn>
+void JobSystem::parallelFor(size_t begin, size_t end, ParallelShape shape, Fn&& fn) {
+    if (begin >= end) return;
+    size_t count = end - begin;
+    size_t grain = shape.grain != 0 ? shape.grain : autoGrain(count);
+    if (count <= grain || m_workers.empty() || shape.maxThreads == 1) {
+        fn(begin, end);
+        return;
+    }
+    
+    // Split eagerly until there are a few chunks per thread, lazily after that
+    int splits = 1;
+    for (size_t t = m_workers.size() + 1; t > 1; t >>= 1) ++splits;
+    
+    std::atomic<int> helpers{(int)shape.maxThreads - 1};
+    JobCounter counter;
+    runRange(begin, end, grain, splits, fn, counter, shape.maxThreads != 0 ? &helpers : nullptr);
+    wait(counter);
+}
+
+template <typename Fn>
+void JobSystem::scheduleRange(size_t begin, size_t end, size_t grain, Fn& fn, JobCounter& counter) {
+    if (begin >= end) return;
+    if (grain == 0) grain = autoGrain(end - begin);
+    
+    int splits = 1;
+    for (size_t t = m_workers.size() + 1; t > 1; t >>= 1) ++splits;
+    
+    schedule([this, begin, end, grain, splits, &fn, &counter]() {
+        runRange(begin, end, grain, splits, fn, counter);
+    }, counter);
+}
+
+template <typename Fn>
+void JobSystem::runRange(size_t begin, size_t end, size_t grain, int splits, Fn& fn, JobCounter& counter,
+                         std::atomic<int>* helpers) {
+    while (begin < end) {
+        // Background ranges step aside between chunks and finish later
+        if (shouldYield()) {
+            schedule([this, begin, end, grain, &fn, &counter, helpers]() {
+                runRange(begin, end, grain, 0, fn, counter, helpers);
+            }, counter);
+            return;
+        }
+        
+        bool split = end - begin > grain && (splits > 0 || hasIdleWorkers());
+        if (split && helpers) {
+            // Capped: only hand work to another thread while a helper slot is free
+            split = helpers->fetch_sub(1, std::memory_order_relaxed) > 0;
+            if (!split) helpers->fetch_add(1, std::memory_order_relaxed);
+        }
+        if (split) {
+            size_t mid = begin + (end - begin) / 2;
+            int childSplits = splits > 0 ? splits - 1 : 0;
+            schedule([this, mid, end, grain, childSplits, &fn, &counter, helpers]() {
+                runRange(mid, end, grain, childSplits, fn, counter, helpers);
+                if (helpers) helpers->fetch_add(1, std::memory_order_relaxed);
+            }, counter);
+            end = mid;
+            splits = childSplits;
+            continue;
+        }
+        
+        // Work through the range a grain at a time so the rest can still be split off
+        size_t stop = std::min(begin + grain, end);
+        fn(begin, stop);
+        begin = stop;
+    }
+}
+
+template <typename T, typename Fn, typename Combine>
+T JobSystem::parallelReduce(size_t begin, size_t end, size_t grain, T identity, Fn&& fn, Combine&& combine) {
+    return parallelReduce(begin, end, ParallelShape{grain, 0}, identity, fn, combine);
+}
+
+template <typename T, typename Fn, typename Combine>
+T JobSystem::parallelReduce(size_t begin, size_t end, ParallelShape shape, T identity, Fn&& fn, Combine&& combine) {
+    if (begin >= end) return identity;
+    size_t count = end - begin;
+    size_t grain = shape.grain != 0 ? shape.grain : autoGrain(count);
+    size_t chunkCount = (count + grain - 1) / grain;
+    
+    // One partial per chunk, written only by whichever thread runs it.
+    // They live on the stack unless the range has unusually many chunks.
+    constexpr size_t INLINE_PARTIALS = 64;
+    std::array<T, INLINE_PARTIALS> inlinePartials;
+    std::vector<T> heapPartials;
+    T* partials = inlinePartials.data();
+    if (chunkCount > INLINE_PARTIALS) {
+        heapPartials.resize(chunkCount);
+        partials = heapPartials.data();
+    }
+    
+    parallelFor(0, chunkCount, ParallelShape{1, shape.maxThreads}, [&](size_t first, size_t last) {
+        for (size_t chunk = first; chunk < last; ++chunk) {
+            size_t chunkBegin = begin + chunk * grain;
+            partials[chunk] = fn(chunkBegin, std::min(chunkBegin + grain, end));
+        }
+    });
+    
+    T result = identity;
+    for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+        result = combine(result, partials[chunk]);
+    }
+    return result;
+}
+
 }
\ No newline at end of file
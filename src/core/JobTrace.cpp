@@ -0,0 +1,135 @@
+#include "core/JobTrace.h"
+#include <cstdio>
+
+namespace Legionfall {
+
+namespace {
+    thread_local const JobTrace* t_traceOwner = nullptr;
+    thread_local void* t_traceBuffer = nullptr;
+    thread_local const char* t_label = nullptr;
+    
+    void writeJsonString(std::ostream& out, const char* text) {
+        out << '"';
+        for (const char* c = text; *c; ++c) {
+            if (*c == '"' || *c == '\\') out << '\\';
+            out << *c;
+        }
+        out << '"';
+    }
+}
+
+JobTrace::JobTrace(size_t capacity)
+    : m_capacity(capacity), m_start(std::chrono::steady_clock::now()) {}
+
+uint64_t JobTrace::now() const {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - m_start).count();
+}
+
+JobTrace::ThreadBuffer* JobTrace::threadBuffer() {
+    if (t_traceOwner != this) {
+        // First span from this thread: give it a ring of its own
+        auto buffer = std::make_unique<ThreadBuffer>();
+        buffer->spans = std::make_unique<Span[]>(m_capacity);
+        
+        std::lock_guard<std::mutex> lock(m_buffersMutex);
+        buffer->name = "Thread " + std::to_string(m_buffers.size());
+        m_buffers.push_back(std::move(buffer));
+        t_traceBuffer = m_buffers.back().get();
+        t_traceOwner = this;
+    }
+    return static_cast<ThreadBuffer*>(t_traceBuffer);
+}
+
+void JobTrace::record(const char* label, uint64_t beginNs, uint64_t endNs) {
+    if (!enabled()) return;
+    
+    ThreadBuffer* buffer = threadBuffer();
+    uint64_t index = buffer->head.load(std::memory_order_relaxed);
+    Span& span = buffer->spans[index % m_capacity];
+    
+    span.sequence.store(index * 2 + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    span.beginNs = beginNs;
+    span.endNs = endNs;
+    span.label = label ? label : "job";
+    span.frame = frame();
+    span.sequence.store(index * 2 + 2, std::memory_order_release);
+    
+    buffer->head.store(index + 1, std::memory_order_release);
+}
+
+void JobTrace::nameThread(std::string name) {
+    if (!enabled()) return;
+    
+    ThreadBuffer* buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(m_buffersMutex);
+    buffer->name = std::move(name);
+}
+
+void JobTrace::writeChromeTrace(std::ostream& out, uint32_t frames) const {
+    uint32_t current = frame();
+    uint32_t firstFrame = current >= frames ? current - frames + 1 : 0;
+    
+    std::lock_guard<std::mutex> lock(m_buffersMutex);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    
+    bool first = true;
+    char timing[96];
+    for (size_t tid = 0; tid < m_buffers.size(); ++tid) {
+        const ThreadBuffer& buffer = *m_buffers[tid];
+        
+        out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+            << ",\"args\":{\"name\":";
+        writeJsonString(out, buffer.name.c_str());
+        out << "}}";
+        first = false;
+        
+        uint64_t head = buffer.head.load(std::memory_order_acquire);
+        uint64_t begin = head > m_capacity ? head - m_capacity : 0;
+        for (uint64_t index = begin; index < head; ++index) {
+            const Span& span = buffer.spans[index % m_capacity];
+            
+            // Skip spans the owner is overwriting or has already replaced
+            uint64_t expected = index * 2 + 2;
+            if (span.sequence.load(std::memory_order_acquire) != expected) continue;
+            uint64_t beginNs = span.beginNs;
+            uint64_t endNs = span.endNs;
+            const char* label = span.label;
+            uint32_t spanFrame = span.frame;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (span.sequence.load(std::memory_order_relaxed) != expected) continue;
+            
+            if (spanFrame < firstFrame) continue;
+            
+            out << ",\n{\"name\":";
+            writeJsonString(out, label);
+            snprintf(timing, sizeof(timing), ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f",
+                     beginNs / 1000.0, (endNs - beginNs) / 1000.0);
+            out << timing << ",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"frame\":" << spanFrame << "}}";
+        }
+    }
+    
+    out << "\n]}\n";
+}
+
+const char* JobTrace::currentLabel() {
+    return t_label;
+}
+
+void JobTrace::setCurrentLabel(const char* label) {
+    t_label = label;
+}
+
+TraceSpan::TraceSpan(JobTrace* trace, const char* label)
+    : m_trace(trace && trace->enabled() ? trace : nullptr), m_label(label), m_outerLabel(t_label) {
+    t_label = label;
+    if (m_trace) m_beginNs = m_trace->now();
+}
+
+TraceSpan::~TraceSpan() {
+    if (m_trace) m_trace->record(m_label, m_beginNs, m_trace->now());
+    t_label = m_outerLabel;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Legionfall {
+
+// Records what every thread ran and when. Each thread writes spans into a
+// ring buffer of its own, so recording takes no locks and never allocates
+// once the thread has its buffer; old spans are overwritten. Spans are
+// tagged with the frame they ran in, and the last few frames can be written
+// out as Chrome trace-event JSON (open it in Perfetto or chrome://tracing).
+class JobTrace {
+public:
+    // capacity is spans per thread; 0 turns recording off
+    explicit JobTrace(size_t capacity);
+    
+    bool enabled() const { return m_capacity != 0; }
+    uint64_t now() const;
+    
+    void record(const char* label, uint64_t beginNs, uint64_t endNs);
+    
+    // Names the calling thread's track in the exported trace
+    void nameThread(std::string name);
+    
+    void beginFrame() { m_frame.fetch_add(1, std::memory_order_relaxed); }
+    uint32_t frame() const { return m_frame.load(std::memory_order_relaxed); }
+    
+    // Writes spans from the last `frames` frames; safe while threads are recording
+    void writeChromeTrace(std::ostream& out, uint32_t frames) const;
+    
+    // Label of the span or job running on this thread; new jobs inherit it
+    static const char* currentLabel();
+    static void setCurrentLabel(const char* label);
+
+private:
+    struct Span {
+        // Even once written; odd while the owner is overwriting it
+        std::atomic<uint64_t> sequence{0};
+        uint64_t beginNs = 0;
+        uint64_t endNs = 0;
+        const char* label = nullptr;
+        uint32_t frame = 0;
+    };
+    
+    struct ThreadBuffer {
+        std::string name;
+        std::unique_ptr<Span[]> spans;
+        std::atomic<uint64_t> head{0};
+    };
+    
+    ThreadBuffer* threadBuffer();
+    
+    size_t m_capacity;
+    std::chrono::steady_clock::time_point m_start;
+    std::atomic<uint32_t> m_frame{0};
+    
+    mutable std::mutex m_buffersMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+};
+
+// Labels everything run or scheduled in its scope, and records the scope
+// itself as a span when trace is non-null.
+class TraceSpan {
+public:
+    TraceSpan(JobTrace* trace, const char* label);
+    ~TraceSpan();
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    JobTrace* m_trace;
+    const char* m_label;
+    const char* m_outerLabel;
+    uint64_t m_beginNs = 0;
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include "core/ParallelGovernor.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Legionfall {
+
+namespace {
+    constexpr size_t CHUNKS_PER_THREAD[] = {1, 4, 16};
+    
+    // Tune again once the workload moves this far from what we tuned for
+    constexpr double COUNT_DRIFT = 0.25;
+    constexpr double COST_DRIFT = 0.5;
+    constexpr uint32_t SETTLE_FRAMES = 10;
+    constexpr uint32_t RETUNE_FRAMES = 1800;
+    constexpr double COST_SMOOTHING = 0.1;
+}
+
+ParallelShape ParallelGovernor::shape(size_t count, size_t workerCount) {
+    size_t maxThreads = workerCount + 1;
+    if (m_candidates.empty() || needsRetune(count, maxThreads)) {
+        startTuning(count, maxThreads);
+    }
+    
+    m_lastCount = count;
+    return m_tuning ? m_candidates[m_candidate].shape : m_best;
+}
+
+bool ParallelGovernor::needsRetune(size_t count, size_t maxThreads) const {
+    if (maxThreads != m_tunedMaxThreads) return true;
+    
+    double countChange = std::fabs((double)count - (double)m_tunedCount) / (double)std::max<size_t>(1, m_tunedCount);
+    if (countChange > COUNT_DRIFT) return true;
+    if (m_tuning) return false;
+    
+    if (m_framesSinceTuning >= RETUNE_FRAMES) return true;
+    return m_framesSinceTuning >= SETTLE_FRAMES &&
+           std::fabs(m_averageCost - m_tunedCost) > COST_DRIFT * m_tunedCost;
+}
+
+void ParallelGovernor::startTuning(size_t count, size_t maxThreads) {
+    m_candidates.clear();
+    m_candidates.push_back({ParallelShape{count, 1}});
+    
+    // Powers of two below the whole pool, then the whole pool itself
+    std::vector<size_t> threadCounts;
+    for (size_t threads = 2; threads < maxThreads; threads *= 2) threadCounts.push_back(threads);
+    if (maxThreads > 1) threadCounts.push_back(maxThreads);
+    
+    for (size_t threads : threadCounts) {
+        for (size_t chunks : CHUNKS_PER_THREAD) {
+            size_t grain = std::max(m_minGrain, (count + threads * chunks - 1) / (threads * chunks));
+            if (grain >= count) continue;
+            
+            bool duplicate = false;
+            for (const Candidate& c : m_candidates) {
+                if (c.shape.maxThreads == threads && c.shape.grain == grain) duplicate = true;
+            }
+            if (!duplicate) m_candidates.push_back({ParallelShape{grain, threads}});
+        }
+    }
+    
+    m_candidate = 0;
+    m_sampleCount = 0;
+    m_tuning = true;
+    m_tunedCount = count;
+    m_tunedMaxThreads = maxThreads;
+    m_stats.tuning = true;
+}
+
+void ParallelGovernor::record(double ms) {
+    double cost = ms * 1e6 / (double)std::max<size_t>(1, m_lastCount);
+    
+    if (!m_tuning) {
+        m_averageCost += (cost - m_averageCost) * COST_SMOOTHING;
+        m_framesSinceTuning++;
+        return;
+    }
+    
+    m_samples[m_sampleCount++] = cost;
+    if (m_sampleCount < SAMPLES_PER_CANDIDATE) return;
+    
+    // The median shrugs off the odd frame where the OS got in the way
+    std::sort(m_samples, m_samples + SAMPLES_PER_CANDIDATE);
+    m_candidates[m_candidate].nsPerElement = m_samples[SAMPLES_PER_CANDIDATE / 2];
+    m_sampleCount = 0;
+    
+    if (++m_candidate == m_candidates.size()) {
+        finishTuning();
+    }
+}
+
+void ParallelGovernor::finishTuning() {
+    const Candidate* best = &m_candidates[0];
+    for (const Candidate& c : m_candidates) {
+        if (c.nsPerElement < best->nsPerElement) best = &c;
+    }
+    
+    m_best = best->shape;
+    m_tunedCost = best->nsPerElement;
+    m_averageCost = m_tunedCost;
+    m_framesSinceTuning = 0;
+    m_tuning = false;
+    
+    m_stats.threads = m_best.maxThreads;
+    m_stats.grain = m_best.grain;
+    m_stats.speedup = m_tunedCost > 0.0 ? m_candidates[0].nsPerElement / m_tunedCost : 1.0;
+    m_stats.tuning = false;
+}
+
+}
\ No newline at end of file
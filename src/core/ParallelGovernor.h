@@ -0,0 +1,76 @@
+#pragma once
+#include "core/JobSystem.h"
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+namespace Legionfall {
+
+// What a governor has settled on
+struct GovernorStats {
+    size_t threads = 1;         // 1 = runs inline on the calling thread
+    size_t grain = 0;
+    double speedup = 1.0;       // measured inline time / time with the chosen shape
+    bool tuning = true;
+};
+
+// Picks the shape of one parallel phase from measurements. It times each
+// candidate thread count and grain size (running inline included) over a
+// few frames, keeps the fastest, and tunes again when the element count or
+// the per-element cost drifts from what it tuned for, or after a while.
+class ParallelGovernor {
+public:
+    // minGrain is the smallest chunk worth handing a thread, in whatever
+    // unit the phase counts (single enemies, 64-enemy blocks, ...)
+    explicit ParallelGovernor(size_t minGrain = 64) : m_minGrain(minGrain) {}
+    
+    ParallelShape shape(size_t count, size_t workerCount);
+    void record(double ms);
+    
+    template <typename Fn>
+    void run(JobSystem& jobs, size_t count, Fn&& fn);
+    
+    const GovernorStats& stats() const { return m_stats; }
+
+private:
+    static constexpr int SAMPLES_PER_CANDIDATE = 5;
+    
+    struct Candidate {
+        ParallelShape shape;
+        double nsPerElement = 0.0;
+    };
+    
+    void startTuning(size_t count, size_t maxThreads);
+    void finishTuning();
+    bool needsRetune(size_t count, size_t maxThreads) const;
+    
+    size_t m_minGrain;
+    std::vector<Candidate> m_candidates;
+    size_t m_candidate = 0;
+    double m_samples[SAMPLES_PER_CANDIDATE] = {};
+    int m_sampleCount = 0;
+    bool m_tuning = false;
+    
+    ParallelShape m_best;
+    size_t m_tunedCount = 0;
+    size_t m_tunedMaxThreads = 0;
+    double m_tunedCost = 0.0;
+    double m_averageCost = 0.0;
+    uint32_t m_framesSinceTuning = 0;
+    
+    size_t m_lastCount = 0;
+    GovernorStats m_stats;
+};
+
+template <typename Fn>
+void ParallelGovernor::run(JobSystem& jobs, size_t count, Fn&& fn) {
+    if (count == 0) return;
+    ParallelShape chosen = shape(count, jobs.threadCount());
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    jobs.parallelFor(0, count, chosen, fn);
+    auto end = std::chrono::high_resolution_clock::now();
+    record(std::chrono::duration<double, std::milli>(end - start).count());
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#include "core/RespawnQueue.h"
+#include <algorithm>
+
+namespace Legionfall {
+
+void RespawnQueue::clear() {
+    m_entries.clear();
+    m_clock = 0.0;
+}
+
+void RespawnQueue::push(uint32_t i, float delay) {
+    Entry entry{m_clock + delay, i};
+    
+    // Shorter delays than those already queued are inserted in order
+    if (m_entries.empty() || m_entries.back().due <= entry.due) {
+        m_entries.push_back(entry);
+    } else {
+        auto at = std::upper_bound(m_entries.begin(), m_entries.end(), entry.due,
+                                   [](double due, const Entry& e) { return due < e.due; });
+        m_entries.insert(at, entry);
+    }
+}
+
+void RespawnQueue::advance(float dt, std::vector<uint32_t>& out) {
+    m_clock += dt;
+    while (!m_entries.empty() && m_entries.front().due <= m_clock) {
+        out.push_back(m_entries.front().index);
+        m_entries.pop_front();
+    }
+}
+
+void RespawnQueue::remap(const std::vector<uint32_t>& order) {
+    m_newIndex.resize(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        m_newIndex[order[i]] = (uint32_t)i;
+    }
+    for (Entry& entry : m_entries) {
+        entry.index = m_newIndex[entry.index];
+    }
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace Legionfall {
+
+// Dead enemies waiting to come back, ordered by when they are due. Deaths
+// are timed from a clock that only moves forward and the delays are fixed,
+// so new entries go on the back and each frame pops only from the front:
+// a frame costs O(respawns) however many enemies lie dead.
+class RespawnQueue {
+public:
+    void clear();
+    
+    // Enemy i comes back once the clock has advanced delay past now
+    void push(uint32_t i, float delay);
+    
+    // Advances the clock and appends every enemy now due to out, oldest first
+    void advance(float dt, std::vector<uint32_t>& out);
+    
+    // Follows EnemyPool::reorder(order), which moved enemy order[i] to slot i
+    void remap(const std::vector<uint32_t>& order);
+    
+    size_t size() const { return m_entries.size(); }
+    bool empty() const { return m_entries.empty(); }
+
+private:
+    struct Entry {
+        double due;
+        uint32_t index;
+    };
+    
+    std::deque<Entry> m_entries;
+    std::vector<uint32_t> m_newIndex;
+    double m_clock = 0.0;
+};
+
+}
\ No newline at end of file
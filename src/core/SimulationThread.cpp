@@ -0,0 +1,116 @@
+#include "core/SimulationThread.h"
+#include "core/JobSystem.h"
+#include <algorithm>
+
+namespace Legionfall {
+
+SimulationThread::SimulationThread(Game& game, JobSystem& jobs, float tickSeconds, int maxCatchUpTicks)
+    : m_game(game), m_jobs(jobs), m_tickSeconds(tickSeconds), m_maxCatchUpTicks(maxCatchUpTicks) {
+    for (size_t slot = 0; slot < SLOT_COUNT; ++slot) {
+        m_snapshots.slot(slot).slot = (uint32_t)slot;
+    }
+}
+
+SimulationThread::~SimulationThread() {
+    stop();
+}
+
+void SimulationThread::setInstanceMemory(size_t slot, InstanceData* memory) {
+    m_snapshots.slot(slot).instances = memory;
+}
+
+void SimulationThread::start() {
+    if (m_running.exchange(true)) return;
+    
+    size_t unset = 0;
+    for (size_t slot = 0; slot < SLOT_COUNT; ++slot) {
+        if (m_snapshots.slot(slot).instances == nullptr) unset++;
+    }
+    m_ownedInstances.resize(unset * Game::maxInstanceCount());
+    for (size_t slot = 0, owned = 0; slot < SLOT_COUNT; ++slot) {
+        FrameSnapshot& snapshot = m_snapshots.slot(slot);
+        if (snapshot.instances == nullptr) {
+            snapshot.instances = m_ownedInstances.data() + owned++ * Game::maxInstanceCount();
+        }
+    }
+    
+    // Readers get the state the game starts in until the first tick lands
+    std::span<const InstanceData> initial = m_game.getInstanceData();
+    std::copy(initial.begin(), initial.end(), m_snapshots.back().instances);
+    publish(0, (uint32_t)initial.size());
+    m_thread = std::thread([this]() { run(); });
+}
+
+void SimulationThread::stop() {
+    if (!m_running.exchange(false)) return;
+    m_thread.join();
+}
+
+void SimulationThread::setInput(const InputState& input) {
+    std::lock_guard<std::mutex> lock(m_inputMutex);
+    m_input = input;
+}
+
+void SimulationThread::run() {
+    using Clock = std::chrono::steady_clock;
+    const auto tick = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(m_tickSeconds));
+    
+    m_jobs.trace().nameThread("Simulation");
+    auto nextTick = Clock::now();
+    uint64_t tickIndex = 0;
+    
+    while (m_running.load(std::memory_order_relaxed)) {
+        auto now = Clock::now();
+        if (m_paused.load(std::memory_order_relaxed)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            nextTick = Clock::now();
+            continue;
+        }
+        if (now < nextTick) {
+            std::this_thread::sleep_until(nextTick);
+            continue;
+        }
+        if (now - nextTick > tick * m_maxCatchUpTicks) {
+            nextTick = now;
+        }
+        
+        InputState input;
+        {
+            std::lock_guard<std::mutex> lock(m_inputMutex);
+            input = m_input;
+        }
+        
+        // The game only writes instances into the slot it is filling; once
+        // published, the render thread and the GPU may be reading it
+        m_game.setInstanceTarget(m_snapshots.back().instances);
+        if (input.restart && m_game.isGameOver()) {
+            m_game.restart(&m_jobs);
+        }
+        {
+            TraceSpan span(&m_jobs.trace(), "Game::update");
+            m_game.update(m_tickSeconds, input, &m_jobs);
+        }
+        uint32_t instanceCount = (uint32_t)m_game.getInstanceData().size();
+        m_game.setInstanceTarget(nullptr);
+        
+        publish(++tickIndex, instanceCount);
+        nextTick += tick;
+    }
+}
+
+void SimulationThread::publish(uint64_t tick, uint32_t instanceCount) {
+    FrameSnapshot& snapshot = m_snapshots.back();
+    snapshot.instanceCount = instanceCount;
+    snapshot.stats = m_game.getStats();
+    m_game.getHeroPosition(snapshot.heroPrevX, snapshot.heroPrevY, 0.0f);
+    m_game.getHeroPosition(snapshot.heroX, snapshot.heroY);
+    snapshot.time = m_game.getTime();
+    snapshot.cameraFollow = m_game.isCameraFollowEnabled();
+    snapshot.gameOver = m_game.isGameOver();
+    snapshot.tick = tick;
+    snapshot.publishedAt = std::chrono::steady_clock::now();
+    
+    m_snapshots.publish();
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+#pragma once
+#include "core/Game.h"
+#include "core/TripleBuffer.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Legionfall {
+
+class JobSystem;
+
+// Everything the render thread needs from one simulation tick. Instances
+// live in the slot's instance memory, which the game writes in place.
+struct FrameSnapshot {
+    uint32_t slot = 0;
+    InstanceData* instances = nullptr;
+    uint32_t instanceCount = 0;
+    ProfilingStats stats;
+    float heroX = 0.0f, heroY = 0.0f;
+    float heroPrevX = 0.0f, heroPrevY = 0.0f;
+    float time = 0.0f;
+    bool cameraFollow = false;
+    bool gameOver = false;
+    uint64_t tick = 0;
+    std::chrono::steady_clock::time_point publishedAt;
+};
+
+// Runs Game::update in fixed ticks on a thread of its own and publishes each
+// finished tick through a triple buffer, so simulating the next tick
+// overlaps recording and presenting the last one. Falling more than
+// maxCatchUpTicks behind drops the backlog instead of running it.
+class SimulationThread {
+public:
+    // Snapshots the render thread may still be drawing from: the one it is
+    // recording now and one per earlier frame the GPU may not have finished
+    static constexpr size_t READER_SLOTS = 2;
+    static constexpr size_t SLOT_COUNT = TripleBuffer<FrameSnapshot, READER_SLOTS>::SLOT_COUNT;
+    
+    SimulationThread(Game& game, JobSystem& jobs, float tickSeconds, int maxCatchUpTicks);
+    ~SimulationThread();
+    
+    // Instance memory for one snapshot slot, holding Game::maxInstanceCount()
+    // instances. Call before start(); slots left unset get memory of their own.
+    void setInstanceMemory(size_t slot, InstanceData* memory);
+    
+    void start();
+    void stop();
+    
+    // Input for the next tick; the latest call wins
+    void setInput(const InputState& input);
+    
+    // Holds the simulation still, e.g. while the window is minimized
+    void setPaused(bool paused) { m_paused.store(paused, std::memory_order_relaxed); }
+    
+    // Render thread: moves to the newest published tick without waiting and
+    // returns false when there is none newer than the current one. Call it
+    // once per frame, after waiting for the frame READER_SLOTS back to finish.
+    bool acquire() { return m_snapshots.acquire(); }
+    const FrameSnapshot& latest() const { return m_snapshots.front(); }
+    
+    float tickSeconds() const { return m_tickSeconds; }
+
+private:
+    void run();
+    void publish(uint64_t tick, uint32_t instanceCount);
+    
+    Game& m_game;
+    JobSystem& m_jobs;
+    float m_tickSeconds;
+    int m_maxCatchUpTicks;
+    
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_paused{false};
+    
+    std::mutex m_inputMutex;
+    InputState m_input;
+    
+    TripleBuffer<FrameSnapshot, READER_SLOTS> m_snapshots;
+    std::vector<InstanceData> m_ownedInstances;
+};
+
+}
\ No newline at end of file
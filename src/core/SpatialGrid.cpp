@@ -0,0 +1,106 @@
+#include "core/SpatialGrid.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace Legionfall {
+
+void SpatialGrid::configure(float minX, float minY, float maxX, float maxY, float cellSize) {
+    m_minX = minX;
+    m_minY = minY;
+    m_invCellSize = 1.0f / cellSize;
+    m_cellsX = std::max(1u, (uint32_t)std::ceil((maxX - minX) * m_invCellSize));
+    m_cellsY = std::max(1u, (uint32_t)std::ceil((maxY - minY) * m_invCellSize));
+    m_cellCount = (size_t)m_cellsX * m_cellsY;
+    clear();
+}
+
+void SpatialGrid::clear() {
+    m_cellStart.assign(m_cellCount + 1, 0);
+    m_index.clear();
+    m_x.clear();
+    m_y.clear();
+}
+
+uint32_t SpatialGrid::cellX(float x) const {
+    float cell = (x - m_minX) * m_invCellSize;
+    if (!(cell > 0.0f)) return 0;
+    return std::min((uint32_t)cell, m_cellsX - 1);
+}
+
+uint32_t SpatialGrid::cellY(float y) const {
+    float cell = (y - m_minY) * m_invCellSize;
+    if (!(cell > 0.0f)) return 0;
+    return std::min((uint32_t)cell, m_cellsY - 1);
+}
+
+void SpatialGrid::runsInRadius(float x, float y, float radius, uint32_t maxRun, std::vector<SlotRun>& runs) const {
+    runs.clear();
+    if (m_index.empty() || radius < 0.0f) return;
+    
+    uint32_t x0 = cellX(x - radius), x1 = cellX(x + radius);
+    uint32_t y0 = cellY(y - radius), y1 = cellY(y + radius);
+    for (uint32_t cy = y0; cy <= y1; ++cy) {
+        uint32_t begin = m_cellStart[(size_t)cy * m_cellsX + x0];
+        uint32_t end = m_cellStart[(size_t)cy * m_cellsX + x1 + 1];
+        for (; begin < end; begin += std::min(maxRun, end - begin)) {
+            runs.push_back({begin, begin + std::min(maxRun, end - begin)});
+        }
+    }
+}
+
+void SpatialGrid::beginBuild(const EnemyPool& enemies) {
+    m_chunkCount = (enemies.blockCount() + CHUNK_BLOCKS - 1) / CHUNK_BLOCKS;
+    m_chunkCursor.assign(m_chunkCount * m_cellCount, 0);
+    m_cellOf.resize(enemies.blockCount() * EnemyPool::BLOCK);
+}
+
+void SpatialGrid::countChunk(const EnemyPool& enemies, size_t chunk) {
+    uint32_t* counts = m_chunkCursor.data() + chunk * m_cellCount;
+    size_t lastBlock = std::min(enemies.blockCount(), (chunk + 1) * CHUNK_BLOCKS);
+    
+    for (size_t block = chunk * CHUNK_BLOCKS; block < lastBlock; ++block) {
+        for (uint64_t bits = enemies.aliveMask(block); bits != 0; bits &= bits - 1) {
+            size_t i = block * EnemyPool::BLOCK + std::countr_zero(bits);
+            uint32_t cell = cellY(enemies.y[i]) * m_cellsX + cellX(enemies.x[i]);
+            m_cellOf[i] = cell;
+            counts[cell]++;
+        }
+    }
+}
+
+// Cell-major prefix sum: within a cell, earlier chunks get earlier slots
+void SpatialGrid::computeOffsets() {
+    uint32_t total = 0;
+    for (size_t cell = 0; cell < m_cellCount; ++cell) {
+        m_cellStart[cell] = total;
+        for (size_t chunk = 0; chunk < m_chunkCount; ++chunk) {
+            uint32_t& cursor = m_chunkCursor[chunk * m_cellCount + cell];
+            uint32_t count = cursor;
+            cursor = total;
+            total += count;
+        }
+    }
+    m_cellStart[m_cellCount] = total;
+    
+    m_index.resize(total);
+    m_x.resize(total);
+    m_y.resize(total);
+}
+
+void SpatialGrid::scatterChunk(const EnemyPool& enemies, size_t chunk) {
+    uint32_t* cursors = m_chunkCursor.data() + chunk * m_cellCount;
+    size_t lastBlock = std::min(enemies.blockCount(), (chunk + 1) * CHUNK_BLOCKS);
+    
+    for (size_t block = chunk * CHUNK_BLOCKS; block < lastBlock; ++block) {
+        for (uint64_t bits = enemies.aliveMask(block); bits != 0; bits &= bits - 1) {
+            size_t i = block * EnemyPool::BLOCK + std::countr_zero(bits);
+            uint32_t slot = cursors[m_cellOf[i]]++;
+            m_index[slot] = (uint32_t)i;
+            m_x[slot] = enemies.x[i];
+            m_y[slot] = enemies.y[i];
+        }
+    }
+}
+
+}
\ No newline at end of file
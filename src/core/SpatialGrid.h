@@ -0,0 +1,134 @@
+#pragma once
+#include "core/EnemyPool.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Legionfall {
+
+// Uniform grid over the arena holding the alive enemies, sorted by cell.
+// Rebuilt each frame with a counting sort: fixed chunks of blocks count
+// their enemies per cell, a prefix sum turns the counts into offsets, and
+// the chunks scatter into place. Chunks don't depend on scheduling, so
+// the order within a cell is always ascending enemy index.
+//
+// Queries see positions as of the last build; callers that run after
+// enemies have moved widen the query by how far they can have moved and
+// test the live positions themselves.
+class SpatialGrid {
+public:
+    // Slots [begin, end) of the grid's entries
+    struct SlotRun {
+        uint32_t begin, end;
+    };
+    
+    // Blocks of 64 enemies per build chunk
+    static constexpr size_t CHUNK_BLOCKS = 16;
+    
+    // Positions outside the bounds fall into the edge cells
+    void configure(float minX, float minY, float maxX, float maxY, float cellSize);
+    
+    // forEach(count, fn) must call fn(first, last) over chunk ranges covering
+    // [0, count), in any order and on any threads
+    template <typename ForEach>
+    void build(const EnemyPool& enemies, ForEach&& forEach);
+    void clear();
+    
+    // Calls fn(index) for each enemy whose position lies in the box / circle
+    template <typename Fn>
+    void forEachInBox(float minX, float minY, float maxX, float maxY, Fn&& fn) const;
+    template <typename Fn>
+    void forEachInRadius(float x, float y, float radius, Fn&& fn) const;
+    
+    // Every entry of the cells a circle overlaps, as runs of at most maxRun
+    // slots in cell order, for spreading a query over threads. Entries are
+    // not tested against the circle. Cells in a row are adjacent in the
+    // entry array, so each row of cells is one contiguous range.
+    void runsInRadius(float x, float y, float radius, uint32_t maxRun, std::vector<SlotRun>& runs) const;
+    
+    size_t entryCount() const { return m_index.size(); }
+    size_t cellCount() const { return m_cellCount; }
+    
+    // Raw access for passes that walk the grid cell by cell. Entries
+    // [cellBegin(c), cellEnd(c)) are cell c's; cell (cx, cy) is cy * cellsX() + cx.
+    uint32_t cellsX() const { return m_cellsX; }
+    uint32_t cellX(float x) const;
+    uint32_t cellY(float y) const;
+    uint32_t cellBegin(size_t cell) const { return m_cellStart[cell]; }
+    uint32_t cellEnd(size_t cell) const { return m_cellStart[cell + 1]; }
+    uint32_t entryIndex(uint32_t slot) const { return m_index[slot]; }
+    float entryX(uint32_t slot) const { return m_x[slot]; }
+    float entryY(uint32_t slot) const { return m_y[slot]; }
+
+private:
+    
+    void beginBuild(const EnemyPool& enemies);
+    void countChunk(const EnemyPool& enemies, size_t chunk);
+    void computeOffsets();
+    void scatterChunk(const EnemyPool& enemies, size_t chunk);
+    
+    float m_minX = 0.0f, m_minY = 0.0f;
+    float m_invCellSize = 1.0f;
+    uint32_t m_cellsX = 0, m_cellsY = 0;
+    size_t m_cellCount = 0;
+    size_t m_chunkCount = 0;
+    
+    // m_cellStart[c] .. m_cellStart[c + 1] are cell c's entries
+    std::vector<uint32_t> m_cellStart;
+    std::vector<uint32_t> m_index;
+    std::vector<float> m_x, m_y;
+    
+    // Build scratch: each enemy's cell, and per chunk and cell a count that
+    // becomes that chunk's write cursor into the cell
+    std::vector<uint32_t> m_cellOf;
+    std::vector<uint32_t> m_chunkCursor;
+};
+
+template <typename ForEach>
+void SpatialGrid::build(const EnemyPool& enemies, ForEach&& forEach) {
+    beginBuild(enemies);
+    forEach(m_chunkCount, [this, &enemies](size_t first, size_t last) {
+        for (size_t chunk = first; chunk < last; ++chunk) countChunk(enemies, chunk);
+    });
+    computeOffsets();
+    forEach(m_chunkCount, [this, &enemies](size_t first, size_t last) {
+        for (size_t chunk = first; chunk < last; ++chunk) scatterChunk(enemies, chunk);
+    });
+}
+
+template <typename Fn>
+void SpatialGrid::forEachInBox(float minX, float minY, float maxX, float maxY, Fn&& fn) const {
+    if (m_index.empty() || minX > maxX || minY > maxY) return;
+    
+    uint32_t x0 = cellX(minX), x1 = cellX(maxX);
+    uint32_t y0 = cellY(minY), y1 = cellY(maxY);
+    for (uint32_t cy = y0; cy <= y1; ++cy) {
+        for (uint32_t cx = x0; cx <= x1; ++cx) {
+            size_t cell = (size_t)cy * m_cellsX + cx;
+            for (uint32_t s = m_cellStart[cell]; s < m_cellStart[cell + 1]; ++s) {
+                if (m_x[s] >= minX && m_x[s] <= maxX && m_y[s] >= minY && m_y[s] <= maxY) fn(m_index[s]);
+            }
+        }
+    }
+}
+
+template <typename Fn>
+void SpatialGrid::forEachInRadius(float x, float y, float radius, Fn&& fn) const {
+    if (m_index.empty() || radius < 0.0f) return;
+    
+    float radiusSq = radius * radius;
+    uint32_t x0 = cellX(x - radius), x1 = cellX(x + radius);
+    uint32_t y0 = cellY(y - radius), y1 = cellY(y + radius);
+    for (uint32_t cy = y0; cy <= y1; ++cy) {
+        for (uint32_t cx = x0; cx <= x1; ++cx) {
+            size_t cell = (size_t)cy * m_cellsX + cx;
+            for (uint32_t s = m_cellStart[cell]; s < m_cellStart[cell + 1]; ++s) {
+                float dx = m_x[s] - x;
+                float dy = m_y[s] - y;
+                if (dx * dx + dy * dy <= radiusSq) fn(m_index[s]);
+            }
+        }
+    }
+}
+
+}
\ No newline at end of file
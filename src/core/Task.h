@@ -0,0 +1,299 @@
+#pragma once
+#include "core/JobSystem.h"
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Legionfall {
+
+template <typename T = void>
+class Task;
+
+namespace detail {
+
+// Where a finished coroutine hands control: straight to an awaiting
+// coroutine, or to a counter when it was started by spawn() or whenAll()
+struct TaskPromiseBase {
+    std::coroutine_handle<> continuation;
+    JobSystem* jobs = nullptr;
+    JobCounter* doneCounter = nullptr;
+    bool detached = false;
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            TaskPromiseBase& promise = handle.promise();
+            if (promise.continuation) return promise.continuation;
+
+            JobSystem* jobs = promise.jobs;
+            JobCounter* counter = promise.doneCounter;
+            if (promise.detached) handle.destroy();
+            if (counter) jobs->signal(*counter);
+            return std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { std::terminate(); }
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase {
+    std::optional<T> value;
+
+    Task<T> get_return_object();
+    void return_value(T result) { value = std::move(result); }
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+    Task<void> get_return_object();
+    void return_void() {}
+};
+
+}
+
+// Lazily started coroutine. co_await-ing a Task runs it on the awaiting
+// thread and resumes the awaiter when it finishes; any co_await inside it
+// on the JobSystem (resumeOn, parallelForAsync, whenAll, FrameCounter)
+// suspends without blocking a thread and resumes on a worker.
+template <typename T>
+class [[nodiscard]] Task {
+public:
+    using promise_type = detail::TaskPromise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Task() = default;
+    explicit Task(Handle handle) : m_handle(handle) {}
+    Task(Task&& other) noexcept : m_handle(std::exchange(other.m_handle, {})) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (m_handle) m_handle.destroy();
+            m_handle = std::exchange(other.m_handle, {});
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() { if (m_handle) m_handle.destroy(); }
+
+    bool await_ready() const noexcept { return !m_handle || m_handle.done(); }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        m_handle.promise().continuation = awaiting;
+        return m_handle;
+    }
+
+    T await_resume() {
+        if constexpr (!std::is_void_v<T>) {
+            return std::move(*m_handle.promise().value);
+        }
+    }
+
+    Handle handle() const { return m_handle; }
+    Handle release() { return std::exchange(m_handle, {}); }
+
+private:
+    Handle m_handle;
+};
+
+namespace detail {
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() {
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+}
+
+// Starts a task on a worker and lets it run to completion on its own.
+// counter drains when it finishes, so owners can wait for it on shutdown.
+inline void spawn(JobSystem& jobs, Task<void> task, JobCounter& counter) {
+    auto handle = task.release();
+    handle.promise().jobs = &jobs;
+    handle.promise().doneCounter = &counter;
+    handle.promise().detached = true;
+
+    counter.pending.fetch_add(1, std::memory_order_relaxed);
+    jobs.scheduleDetached([handle]() { handle.resume(); });
+}
+
+// co_await resumeOn(jobs) continues the coroutine on a worker thread,
+// at the given priority or else at that of the job it is running in
+inline auto resumeOn(JobSystem& jobs, JobPriority priority) {
+    struct Awaiter {
+        JobSystem& jobs;
+        JobPriority priority;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) {
+            jobs.scheduleDetached([handle]() { handle.resume(); }, priority);
+        }
+        void await_resume() noexcept {}
+    };
+    return Awaiter{jobs, priority};
+}
+
+inline auto resumeOn(JobSystem& jobs) {
+    return resumeOn(jobs, JobSystem::currentPriority());
+}
+
+// co_await parallelForAsync(...) is parallelFor without the blocking wait:
+// the coroutine resumes on whichever worker finishes the last range.
+template <typename Fn>
+auto parallelForAsync(JobSystem& jobs, size_t begin, size_t end, size_t grain, Fn fn) {
+    struct Awaiter {
+        JobSystem& jobs;
+        size_t begin, end, grain;
+        Fn fn;
+        JobCounter counter;
+
+        bool await_ready() const noexcept { return begin >= end; }
+        void await_suspend(std::coroutine_handle<> handle) {
+            counter.pending.store(1, std::memory_order_relaxed);
+            jobs.continueWith(counter, [handle]() { handle.resume(); });
+            jobs.scheduleRange(begin, end, grain, fn, counter);
+            jobs.signal(counter);
+        }
+        void await_resume() noexcept {}
+    };
+    return Awaiter{jobs, begin, end, grain, std::move(fn), {}};
+}
+
+// Runs every task concurrently and resumes once all of them have finished
+inline Task<void> whenAll(JobSystem& jobs, std::vector<Task<void>> tasks) {
+    struct Awaiter {
+        JobSystem& jobs;
+        std::vector<Task<void>>& tasks;
+        JobCounter counter;
+
+        bool await_ready() const noexcept { return tasks.empty(); }
+        void await_suspend(std::coroutine_handle<> handle) {
+            counter.pending.store(1, std::memory_order_relaxed);
+            jobs.continueWith(counter, [handle]() { handle.resume(); });
+
+            for (Task<void>& task : tasks) {
+                auto child = task.handle();
+                child.promise().jobs = &jobs;
+                child.promise().doneCounter = &counter;
+                counter.pending.fetch_add(1, std::memory_order_relaxed);
+                jobs.scheduleDetached([child]() { child.resume(); });
+            }
+            jobs.signal(counter);
+        }
+        void await_resume() noexcept {}
+    };
+    co_await Awaiter{jobs, tasks, {}};
+}
+
+// A JobCounter a coroutine can co_await long after the work on it started,
+// even once it has finished. open() before scheduling anything on
+// counter() and close() once everything is scheduled; the continuation is
+// in place before any work runs, as continueWith requires. Whichever comes
+// second, the work finishing or the co_await, resumes the coroutine, so no
+// thread ever waits for the other.
+class AwaitableCounter {
+public:
+    void open(JobSystem& jobs) {
+        m_jobs = &jobs;
+        m_arrivals.store(0, std::memory_order_relaxed);
+        m_counter.pending.store(1, std::memory_order_relaxed);
+        jobs.continueWith(m_counter, [this]() { arrive(); });
+    }
+    void close() { m_jobs->signal(m_counter); }
+    JobCounter& counter() { return m_counter; }
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> handle) {
+        m_waiter = handle;
+        return m_arrivals.fetch_add(1, std::memory_order_acq_rel) == 0;
+    }
+    void await_resume() noexcept {}
+
+private:
+    void arrive() {
+        if (m_arrivals.fetch_add(1, std::memory_order_acq_rel) == 1) m_waiter.resume();
+    }
+
+    JobSystem* m_jobs = nullptr;
+    JobCounter m_counter;
+    std::atomic<int> m_arrivals{0};
+    std::coroutine_handle<> m_waiter;
+};
+
+// Monotonic frame index that coroutines can sleep on. advance() is called
+// once per frame; coroutines whose frame has arrived are resumed as jobs on
+// the given counter, so the caller decides whether to wait for them.
+class FrameCounter {
+public:
+    uint64_t current() const { return m_frame.load(std::memory_order_acquire); }
+
+    auto until(uint64_t frame) {
+        struct Awaiter {
+            FrameCounter& frames;
+            uint64_t frame;
+
+            bool await_ready() const noexcept { return frames.current() >= frame; }
+            bool await_suspend(std::coroutine_handle<> handle) {
+                std::lock_guard<std::mutex> lock(frames.m_mutex);
+                if (frames.current() >= frame) return false;
+                frames.m_waiters.push_back({frame, handle});
+                return true;
+            }
+            void await_resume() noexcept {}
+        };
+        return Awaiter{*this, frame};
+    }
+
+    auto next() { return until(current() + 1); }
+    auto delay(uint64_t frames) { return until(current() + frames); }
+
+    void advance(JobSystem& jobs, JobCounter& counter) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            uint64_t frame = m_frame.fetch_add(1, std::memory_order_acq_rel) + 1;
+
+            size_t kept = 0;
+            for (const Waiter& waiter : m_waiters) {
+                if (waiter.frame <= frame) {
+                    m_ready.push_back(waiter.handle);
+                } else {
+                    m_waiters[kept++] = waiter;
+                }
+            }
+            m_waiters.resize(kept);
+        }
+
+        // Resume outside the lock; the coroutines may wait on us again
+        for (auto handle : m_ready) {
+            jobs.schedule([handle]() { handle.resume(); }, counter);
+        }
+        m_ready.clear();
+    }
+
+private:
+    struct Waiter {
+        uint64_t frame;
+        std::coroutine_handle<> handle;
+    };
+
+    std::mutex m_mutex;
+    std::atomic<uint64_t> m_frame{0};
+    std::vector<Waiter> m_waiters;
+    std::vector<std::coroutine_handle<>> m_ready;
+};
+
+}
\ No newline at end of file
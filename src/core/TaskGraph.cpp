@@ -0,0 +1,80 @@
+#include "core/TaskGraph.h"
+#include "core/JobSystem.h"
+
+namespace Legionfall {
+
+TaskGraph::Task TaskGraph::add(const char* name, std::function<void()> fn, std::initializer_list<Task> dependencies) {
+    Task task = (Task)m_nodes.size();
+    auto node = std::make_unique<Node>();
+    node->name = name;
+    node->fn = std::move(fn);
+    node->dependencyCount = (int)dependencies.size();
+    
+    for (Task dependency : dependencies) {
+        m_nodes[dependency]->successors.push_back(task);
+    }
+    if (dependencies.size() == 0) {
+        m_roots.push_back(task);
+    }
+    
+    m_nodes.push_back(std::move(node));
+    return task;
+}
+
+void TaskGraph::run(JobSystem* jobs) {
+    if (jobs == nullptr) {
+        for (auto& node : m_nodes) {
+            TraceSpan span(nullptr, node->name);
+            node->fn();
+        }
+        return;
+    }
+    
+    for (auto& node : m_nodes) {
+        node->remaining.store(node->dependencyCount, std::memory_order_relaxed);
+    }
+    
+    // Every task is scheduled against m_counter before its predecessor
+    // finishes, so the counter can't drain until the whole graph has run
+    for (Task root : m_roots) {
+        schedule(*jobs, root);
+    }
+    jobs->wait(m_counter);
+}
+
+void TaskGraph::runFrom(JobSystem& jobs, Task task) {
+    while (true) {
+        Node& node = *m_nodes[task];
+        {
+            TraceSpan span(&jobs.trace(), node.name);
+            node.fn();
+        }
+        
+        // Release successors; keep one ready successor on this thread
+        Task next = task;
+        for (Task successor : node.successors) {
+            if (m_nodes[successor]->remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) continue;
+            
+            if (next != task) {
+                schedule(jobs, next);
+            }
+            next = successor;
+        }
+        
+        if (next == task) return;
+        task = next;
+    }
+}
+
+// The job carries the task's name so the trace shows what it was started for
+void TaskGraph::schedule(JobSystem& jobs, Task task) {
+    TraceSpan label(nullptr, m_nodes[task]->name);
+    jobs.schedule([this, &jobs, task]() { runFrom(jobs, task); }, m_counter);
+}
+
+void TaskGraph::clear() {
+    m_nodes.clear();
+    m_roots.clear();
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+#include "core/Job.h"
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+namespace Legionfall {
+
+class JobSystem;
+
+// A reusable set of tasks with dependencies. Build it once, then run() it
+// every frame: each task is scheduled as soon as the tasks it depends on
+// have finished, so independent work overlaps without global barriers.
+class TaskGraph {
+public:
+    using Task = uint32_t;
+    
+    // Dependencies must already be in the graph, so insertion order is
+    // always a valid sequential order. name labels the task in traces.
+    Task add(const char* name, std::function<void()> fn, std::initializer_list<Task> dependencies = {});
+    
+    // Runs every task and returns when all are done. With a null job
+    // system the tasks run inline in insertion order.
+    void run(JobSystem* jobs);
+    
+    size_t size() const { return m_nodes.size(); }
+    void clear();
+
+private:
+    struct Node {
+        const char* name = nullptr;
+        std::function<void()> fn;
+        std::vector<Task> successors;
+        int dependencyCount = 0;
+        std::atomic<int> remaining{0};
+    };
+    
+    void runFrom(JobSystem& jobs, Task task);
+    void schedule(JobSystem& jobs, Task task);
+    
+    std::vector<std::unique_ptr<Node>> m_nodes;
+    std::vector<Task> m_roots;
+    JobCounter m_counter;
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace Legionfall {
+
+// Lock-free single-producer single-consumer triple buffer. The writer fills
+// back() and publishes it; the reader takes the newest published slot with
+// acquire() and reads it through front(). Neither side ever waits: the
+// writer always has a slot of its own, and intermediate publishes the
+// reader never saw are simply overwritten.
+//
+// READER_SLOTS > 1 keeps the reader's last few fronts out of circulation,
+// for readers whose consumers (a GPU with frames in flight) may still be
+// using a slot after moving on from it. There are READER_SLOTS + 2 slots.
+template <typename T, size_t READER_SLOTS = 1>
+class TripleBuffer {
+    static_assert(READER_SLOTS >= 1 && READER_SLOTS <= 6, "slot indices must fit beside the fresh bit");
+
+public:
+    static constexpr size_t SLOT_COUNT = READER_SLOTS + 2;
+    
+    // Slot 0 starts as the writer's, 1 as the middle, the rest the reader's
+    TripleBuffer() {
+        for (size_t i = 0; i < READER_SLOTS; ++i) m_held[i] = (uint8_t)(i + 2);
+    }
+    
+    // Setup only, before either side starts
+    T& slot(size_t i) { return m_slots[i]; }
+    
+    // Writer only
+    T& back() { return m_slots[m_back]; }
+    
+    void publish() {
+        uint8_t old = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel);
+        m_back = old & INDEX;
+    }
+    
+    // Reader only. Returns false when nothing was published since last time;
+    // otherwise front() is the new slot and the oldest held one goes back.
+    bool acquire() {
+        if ((m_middle.load(std::memory_order_relaxed) & FRESH) == 0) return false;
+        uint8_t old = m_middle.exchange(m_held[READER_SLOTS - 1], std::memory_order_acq_rel);
+        for (size_t i = READER_SLOTS - 1; i > 0; --i) {
+            m_held[i] = m_held[i - 1];
+        }
+        m_held[0] = old & INDEX;
+        return true;
+    }
+    
+    const T& front() const { return m_slots[m_held[0]]; }
+
+private:
+    static constexpr uint8_t INDEX = 7;
+    static constexpr uint8_t FRESH = 8;
+    
+    T m_slots[SLOT_COUNT];
+    alignas(64) std::atomic<uint8_t> m_middle{1};
+    alignas(64) uint8_t m_back = 0;
+    alignas(64) uint8_t m_held[READER_SLOTS];
+};
+
+}
\ No newline at end of file
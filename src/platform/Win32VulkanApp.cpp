@@ -1,17 +1,24 @@
 #define WIN32_LEAN_AND_MEAN
 #define NOMINMAX
 #include <windows.h>
+#include <shellapi.h>
 #include "render/Renderer.h"
 #include "core/Game.h"
 #include "core/JobSystem.h"
+#include "core/SimulationThread.h"
+#include <algorithm>
 #include <chrono>
 #include <iostream>
 #include <iomanip>
+#include <cwchar>
+#include <fstream>
+#include <string>
 
 namespace {
     Legionfall::Renderer* g_renderer = nullptr;
     Legionfall::Game* g_game = nullptr;
     Legionfall::JobSystem* g_jobSystem = nullptr;
+    Legionfall::SimulationThread* g_simulation = nullptr;
     Legionfall::InputState g_input{};
     bool g_running = true;
     bool g_minimized = false;
@@ -19,7 +26,28 @@ namespace {
     const wchar_t* CLASS_NAME = L"LegionfallWindow";
 
     constexpr uint32_t INITIAL_ENEMIES = 5000;
+    
+    // The simulation advances in fixed ticks on its own thread whatever the
+    // frame rate. Once it is more than MAX_SIM_STEPS ticks behind it drops
+    // the backlog, so heavy load slows the game down instead of snowballing.
+    constexpr float SIM_DT = 1.0f / 60.0f;
+    constexpr int MAX_SIM_STEPS = 4;
+    
+    // The simulation writes straight into the regions of the renderer's mapped
+    // instance buffer; the slots the render thread holds cover every frame in flight
+    static_assert(Legionfall::SimulationThread::SLOT_COUNT == Legionfall::Renderer::INSTANCE_SLOTS);
+    static_assert(Legionfall::SimulationThread::READER_SLOTS >= Legionfall::Renderer::MAX_FRAMES_IN_FLIGHT);
     bool g_gameOverShown = false;
+    bool g_dumpTrace = false;
+    
+    const wchar_t* TRACE_FILE = L"legionfall_trace.json";
+    
+    struct CommandLineOptions {
+        Legionfall::JobSystemConfig jobs;
+        uint32_t traceFrames = 120;
+        std::wstring traceOnExit;
+        Legionfall::SimdLevel simd = Legionfall::detectSimdLevel();
+    };
 }
 
 LRESULT CALLBACK WindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
@@ -46,6 +74,7 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                 case 'R': g_input.restart = true; break;
                 case VK_OEM_PLUS: case VK_ADD: g_input.increaseEnemies = true; break;
                 case VK_OEM_MINUS: case VK_SUBTRACT: g_input.decreaseEnemies = true; break;
+                case VK_F9: g_dumpTrace = true; break;
                 case VK_ESCAPE: g_running = false; break;
             }
             return 0;
@@ -83,6 +112,63 @@ void UpdateWindowTitle(HWND hwnd, const Legionfall::ProfilingStats& stats, int f
     SetWindowTextW(hwnd, title);
 }
 
+// Reads JobSystem and tracing settings from the command line:
+//   --workers N  --bg-workers N  --pin  --spin-us N  --yield-us N
+//   --trace-capacity N  --trace-frames N  --trace FILE
+//   --simd scalar|sse2|avx2|avx512
+CommandLineOptions ParseCommandLine() {
+    CommandLineOptions options;
+    Legionfall::JobSystemConfig& config = options.jobs;
+    int argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    if (!argv) return options;
+    
+    for (int i = 1; i < argc; ++i) {
+        const wchar_t* arg = argv[i];
+        const wchar_t* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        
+        if (wcscmp(arg, L"--pin") == 0) {
+            config.pinWorkers = true;
+        } else if (value && wcscmp(arg, L"--workers") == 0) {
+            config.workerCount = wcstoul(value, nullptr, 10); ++i;
+        } else if (value && wcscmp(arg, L"--bg-workers") == 0) {
+            config.backgroundWorkers = wcstoul(value, nullptr, 10); ++i;
+        } else if (value && wcscmp(arg, L"--spin-us") == 0) {
+            config.spinMicros = (uint32_t)wcstoul(value, nullptr, 10); ++i;
+        } else if (value && wcscmp(arg, L"--yield-us") == 0) {
+            config.yieldMicros = (uint32_t)wcstoul(value, nullptr, 10); ++i;
+        } else if (value && wcscmp(arg, L"--trace-capacity") == 0) {
+            config.traceCapacity = wcstoul(value, nullptr, 10); ++i;
+        } else if (value && wcscmp(arg, L"--trace-frames") == 0) {
+            options.traceFrames = (uint32_t)wcstoul(value, nullptr, 10); ++i;
+        } else if (value && wcscmp(arg, L"--trace") == 0) {
+            options.traceOnExit = value; ++i;
+        } else if (value && wcscmp(arg, L"--simd") == 0) {
+            if (wcscmp(value, L"scalar") == 0) options.simd = Legionfall::SimdLevel::Scalar;
+            else if (wcscmp(value, L"sse2") == 0) options.simd = Legionfall::SimdLevel::SSE2;
+            else if (wcscmp(value, L"avx2") == 0) options.simd = Legionfall::SimdLevel::AVX2;
+            else if (wcscmp(value, L"avx512") == 0) options.simd = Legionfall::SimdLevel::AVX512;
+            else std::wcout << L" [!] Unknown SIMD level: " << value << std::endl;
+            ++i;
+        } else {
+            std::wcout << L" [!] Ignoring unknown argument: " << arg << std::endl;
+        }
+    }
+    
+    LocalFree(argv);
+    return options;
+}
+
+void DumpTrace(const wchar_t* path, uint32_t frames) {
+    std::ofstream out(path);
+    if (!out) {
+        std::wcout << L" [!] Could not write trace to " << path << std::endl;
+        return;
+    }
+    g_jobSystem->trace().writeChromeTrace(out, frames);
+    std::wcout << L" [+] Wrote last " << frames << L" frames of job trace to " << path << std::endl;
+}
+
 void PrintBanner() {
     std::cout << R"(
   _                _              __       _ _ 
@@ -118,19 +204,31 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow) {
         (sw - (r.right - r.left)) / 2, (sh - (r.bottom - r.top)) / 2,
         r.right - r.left, r.bottom - r.top, nullptr, nullptr, hInstance, nullptr);
 
-    g_jobSystem = new Legionfall::JobSystem();
+    CommandLineOptions options = ParseCommandLine();
+    g_jobSystem = new Legionfall::JobSystem(options.jobs);
+    g_jobSystem->trace().nameThread("Main");
     g_game = new Legionfall::Game();
+    g_game->setSimdLevel(options.simd);
     g_renderer = new Legionfall::Renderer();
     
-    std::cout << " [+] JobSystem: " << g_jobSystem->threadCount() << " worker threads" << std::endl;
+    const Legionfall::JobSystemConfig& jobConfig = g_jobSystem->config();
+    std::cout << " [+] JobSystem: " << g_jobSystem->threadCount() << " worker threads"
+              << " (" << jobConfig.backgroundWorkers << " background"
+              << (jobConfig.pinWorkers ? ", pinned" : "")
+              << ", spin " << jobConfig.spinMicros << "us, yield " << jobConfig.yieldMicros << "us)" << std::endl;
 
-    if (!g_renderer->init(hwnd, hInstance, g_width, g_height)) {
+    if (!g_renderer->init(hwnd, hInstance, g_width, g_height, Legionfall::Game::maxInstanceCount())) {
         MessageBoxW(hwnd, L"Vulkan initialization failed!", L"Error", MB_OK);
         return 1;
     }
 
-    g_game->init(INITIAL_ENEMIES);
+    g_game->init(INITIAL_ENEMIES, g_jobSystem);
+    if (!g_renderer->uploadStaticInstances(g_game->getStaticInstances())) {
+        std::cout << " [!] Static instance upload failed" << std::endl;
+    }
     std::cout << " [+] Spawned " << INITIAL_ENEMIES << " enemies" << std::endl;
+    std::cout << " [+] Enemy movement kernel: " << g_game->getStats().simdKernel
+              << " (CPU supports " << Legionfall::simdLevelName(Legionfall::detectSimdLevel()) << ")" << std::endl;
     
     ShowWindow(hwnd, nCmdShow);
     SetForegroundWindow(hwnd);
@@ -145,6 +243,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow) {
     std::cout << "   C              = Toggle Camera Follow        " << std::endl;
     std::cout << "   P              = Toggle Parallel/Single      " << std::endl;
     std::cout << "   H              = Toggle Heavy Work Mode      " << std::endl;
+    std::cout << "   F9             = Dump Job Trace (JSON)       " << std::endl;
     std::cout << "   ESC            = Exit                        " << std::endl;
     std::cout << "================================================" << std::endl;
     std::cout << std::endl;
@@ -159,6 +258,12 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow) {
     
     float cameraX = 0.0f, cameraY = 0.0f;
     
+    g_simulation = new Legionfall::SimulationThread(*g_game, *g_jobSystem, SIM_DT, MAX_SIM_STEPS);
+    for (uint32_t slot = 0; slot < Legionfall::Renderer::INSTANCE_SLOTS; slot++) {
+        g_simulation->setInstanceMemory(slot, g_renderer->instanceSlot(slot));
+    }
+    g_simulation->start();
+    
     MSG msg{};
     while (g_running) {
         while (PeekMessageW(&msg, nullptr, 0, 0, PM_REMOVE)) {
@@ -171,22 +276,35 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow) {
         float dt = std::chrono::duration<float>(now - lastTime).count();
         lastTime = now;
         if (dt > 0.1f) dt = 0.1f;
+        g_simulation->setPaused(g_minimized);
         if (g_minimized) { Sleep(10); continue; }
 
-        // Handle restart
-        if (g_input.restart && g_game->isGameOver()) {
-            g_game->restart();
+        g_jobSystem->trace().beginFrame();
+        g_simulation->setInput(g_input);
+        
+        // Wait for the GPU first: acquire() hands the slot of the frame before
+        // the previous one back to the simulation to write into
+        g_renderer->beginFrame();
+        
+        // Newest finished tick; the simulation is already working on the next
+        g_simulation->acquire();
+        const Legionfall::FrameSnapshot& snapshot = g_simulation->latest();
+        
+        if (g_gameOverShown && !snapshot.gameOver) {
             g_gameOverShown = false;
             std::cout << std::endl << ">>> GAME RESTARTED! <<<" << std::endl << std::endl;
         }
-
-        g_game->update(dt, g_input, g_jobSystem);
+        
+        // Draw between the snapshot's tick and the one before it, by how long
+        // ago it was published
+        float sincePublish = std::chrono::duration<float>(std::chrono::steady_clock::now() - snapshot.publishedAt).count();
+        float simAlpha = std::clamp(sincePublish / SIM_DT, 0.0f, 1.0f);
         
         // Camera
-        float heroX, heroY;
-        g_game->getHeroPosition(heroX, heroY);
+        float heroX = snapshot.heroPrevX + (snapshot.heroX - snapshot.heroPrevX) * simAlpha;
+        float heroY = snapshot.heroPrevY + (snapshot.heroY - snapshot.heroPrevY) * simAlpha;
         
-        if (g_game->isCameraFollowEnabled()) {
+        if (snapshot.cameraFollow) {
             float followSpeed = 5.0f;
             cameraX += (heroX - cameraX) * followSpeed * dt;
             cameraY += (heroY - cameraY) * followSpeed * dt;
@@ -195,16 +313,27 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow) {
             cameraY += (0.0f - cameraY) * 3.0f * dt;
         }
         
-        g_renderer->setCameraPosition(cameraX, cameraY);
-        g_renderer->updateInstanceBuffer(g_game->getInstanceData());
-        g_renderer->drawFrame();
+        {
+            Legionfall::TraceSpan span(&g_jobSystem->trace(), "render");
+            g_renderer->setCameraPosition(cameraX, cameraY);
+            g_renderer->setInterpolation(simAlpha);
+            g_renderer->setHeroPosition(heroX, heroY);
+            g_renderer->setTime(snapshot.time - (1.0f - simAlpha) * SIM_DT);
+            g_renderer->setInstances(snapshot.slot, snapshot.instanceCount);
+            g_renderer->drawFrame();
+        }
+        
+        if (g_dumpTrace) {
+            g_dumpTrace = false;
+            DumpTrace(TRACE_FILE, options.traceFrames);
+        }
 
         frameCount++;
         frameTimeAccum += dt * 1000.0;
 
         double timeSincePrint = std::chrono::duration<double>(now - lastPrintTime).count();
         if (timeSincePrint >= 1.0) {
-            auto& stats = g_game->getStats();
+            auto& stats = snapshot.stats;
             int fps = frameCount;
             double avgFrameTime = frameTimeAccum / frameCount;
             
@@ -219,6 +348,9 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow) {
                           << " | " << stats.aliveCount << " alive"
                           << " | " << (stats.parallelEnabled ? "PAR" : "SEQ")
                           << "(" << stats.threadCount << ")"
+                          << " | move " << stats.moveGovernor.threads << "t/" << stats.moveGovernor.grain
+                          << " x" << stats.moveGovernor.speedup
+                          << (stats.moveGovernor.tuning ? " tuning" : "")
                           << std::endl;
             }
             
@@ -230,7 +362,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow) {
         }
         
         // Game over handling
-        auto& stats = g_game->getStats();
+        auto& stats = snapshot.stats;
         if (stats.heroHealth <= 0 && !g_gameOverShown) {
             g_gameOverShown = true;
             std::cout << std::endl;
@@ -245,12 +377,18 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow) {
         }
     }
 
+    g_simulation->stop();
+    
     std::cout << std::endl;
     std::cout << "================================================" << std::endl;
     std::cout << " Thanks for playing LEGIONFALL!                 " << std::endl;
     std::cout << "================================================" << std::endl;
     
-    delete g_renderer; delete g_game; delete g_jobSystem;
+    if (!options.traceOnExit.empty()) {
+        DumpTrace(options.traceOnExit.c_str(), options.traceFrames);
+    }
+    
+    delete g_simulation; delete g_renderer; delete g_game; delete g_jobSystem;
     DestroyWindow(hwnd);
     Sleep(500);
     FreeConsole();
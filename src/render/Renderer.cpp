@@ -24,7 +24,7 @@ static const std::vector<Vertex> TRIANGLE_VERTICES = {
 Renderer::Renderer() = default;
 Renderer::~Renderer() { cleanup(); }
 
-bool Renderer::init(HWND hwnd, HINSTANCE hinstance, uint32_t width, uint32_t height) {
+bool Renderer::init(HWND hwnd, HINSTANCE hinstance, uint32_t width, uint32_t height, uint32_t maxInstances) {
     m_hwnd = hwnd;
     m_hinstance = hinstance;
     m_width = width;
@@ -43,7 +43,7 @@ bool Renderer::init(HWND hwnd, HINSTANCE hinstance, uint32_t width, uint32_t hei
     if (!createFramebuffers()) { LOG("Failed: createFramebuffers"); return false; }
     if (!createCommandPool()) { LOG("Failed: createCommandPool"); return false; }
     if (!createVertexBuffer()) { LOG("Failed: createVertexBuffer"); return false; }
-    if (!createInstanceBuffer(10000)) { LOG("Failed: createInstanceBuffer"); return false; }
+    if (!createInstanceBuffer(maxInstances)) { LOG("Failed: createInstanceBuffer"); return false; }
     if (!createCommandBuffers()) { LOG("Failed: createCommandBuffers"); return false; }
     if (!createSyncObjects()) { LOG("Failed: createSyncObjects"); return false; }
 
@@ -59,9 +59,16 @@ void Renderer::cleanup() {
 
     cleanupSwapchain();
 
+    destroyStaticInstanceBuffer();
     if (m_instanceBuffer != VK_NULL_HANDLE) {
         vkDestroyBuffer(m_device, m_instanceBuffer, nullptr);
+        m_instanceBuffer = VK_NULL_HANDLE;
+    }
+    if (m_instanceBufferMemory != VK_NULL_HANDLE) {
+        vkUnmapMemory(m_device, m_instanceBufferMemory);
         vkFreeMemory(m_device, m_instanceBufferMemory, nullptr);
+        m_instanceBufferMemory = VK_NULL_HANDLE;
+        m_instanceMapped = nullptr;
     }
     if (m_vertexBuffer != VK_NULL_HANDLE) {
         vkDestroyBuffer(m_device, m_vertexBuffer, nullptr);
@@ -132,36 +139,15 @@ bool Renderer::recreateSwapchain() {
     return true;
 }
 
-void Renderer::updateInstanceBuffer(const std::vector<InstanceData>& instances) {
-    if (instances.empty()) {
-        m_instanceCount = 0;
-        return;
-    }
-
-    size_t dataSize = instances.size() * sizeof(InstanceData);
-
-    // Recreate buffer if needed
-    if (dataSize > m_instanceBufferCapacity) {
-        vkDeviceWaitIdle(m_device);
-        if (m_instanceBuffer != VK_NULL_HANDLE) {
-            vkDestroyBuffer(m_device, m_instanceBuffer, nullptr);
-            vkFreeMemory(m_device, m_instanceBufferMemory, nullptr);
-        }
-        createInstanceBuffer(instances.size() * 2);
-    }
-
-    // Upload data
-    void* data;
-    vkMapMemory(m_device, m_instanceBufferMemory, 0, dataSize, 0, &data);
-    memcpy(data, instances.data(), dataSize);
-    vkUnmapMemory(m_device, m_instanceBufferMemory);
-
-    m_instanceCount = (uint32_t)instances.size();
+void Renderer::beginFrame() {
+    if (!m_initialized) return;
+    vkWaitForFences(m_device, 1, &m_inFlightFences[m_currentFrame], VK_TRUE, UINT64_MAX);
 }
 
 bool Renderer::drawFrame() {
     if (!m_initialized || m_instanceCount == 0) return true;
 
+    // Already signalled when beginFrame() waited on it
     vkWaitForFences(m_device, 1, &m_inFlightFences[m_currentFrame], VK_TRUE, UINT64_MAX);
 
     uint32_t imageIndex;
@@ -217,6 +203,10 @@ bool Renderer::drawFrame() {
     pc.viewScaleY = aspect / m_viewHalfWidth;
     pc.viewOffsetX = m_cameraX;
     pc.viewOffsetY = m_cameraY;
+    pc.heroX = m_heroX;
+    pc.heroY = m_heroY;
+    pc.interpolation = m_interpolation;
+    pc.time = m_time;
     vkCmdPushConstants(m_commandBuffers[m_currentFrame], m_pipelineLayout,
         VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &pc);
 
@@ -225,9 +215,17 @@ bool Renderer::drawFrame() {
     VkDeviceSize offsets[] = {0};
     vkCmdBindVertexBuffers(m_commandBuffers[m_currentFrame], 0, 1, vertexBuffers, offsets);
 
-    // Bind instance buffer
+    // Static instances first, so everything that moves draws over them
+    if (m_staticInstanceCount > 0) {
+        VkBuffer staticBuffers[] = {m_staticInstanceBuffer};
+        vkCmdBindVertexBuffers(m_commandBuffers[m_currentFrame], 1, 1, staticBuffers, offsets);
+        vkCmdDraw(m_commandBuffers[m_currentFrame], m_vertexCount, m_staticInstanceCount, 0, 0);
+    }
+
+    // Bind this tick's region of the instance buffer
     VkBuffer instanceBuffers[] = {m_instanceBuffer};
-    vkCmdBindVertexBuffers(m_commandBuffers[m_currentFrame], 1, 1, instanceBuffers, offsets);
+    VkDeviceSize instanceOffsets[] = {(VkDeviceSize)m_instanceSlot * m_instanceCapacity * sizeof(InstanceData)};
+    vkCmdBindVertexBuffers(m_commandBuffers[m_currentFrame], 1, 1, instanceBuffers, instanceOffsets);
 
     // Draw all instances with one call!
     vkCmdDraw(m_commandBuffers[m_currentFrame], m_vertexCount, m_instanceCount, 0, 0);
@@ -602,27 +600,39 @@ bool Renderer::createPipeline() {
     bindings[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
 
     // Vertex attributes
-    std::array<VkVertexInputAttributeDescription, 4> attributes{};
+    std::array<VkVertexInputAttributeDescription, 6> attributes{};
     // Location 0: Position (per-vertex)
     attributes[0].binding = 0;
     attributes[0].location = 0;
     attributes[0].format = VK_FORMAT_R32G32_SFLOAT;
     attributes[0].offset = 0;
+    // Per-instance attributes are packed; the normalized formats unpack
+    // them to floats in [-1, 1] or [0, 1] and the shader rescales them
     // Location 1: Offset (per-instance)
     attributes[1].binding = 1;
     attributes[1].location = 1;
-    attributes[1].format = VK_FORMAT_R32G32_SFLOAT;
+    attributes[1].format = VK_FORMAT_R16G16_SNORM;
     attributes[1].offset = offsetof(InstanceData, offsetX);
     // Location 2: Color (per-instance)
     attributes[2].binding = 1;
     attributes[2].location = 2;
-    attributes[2].format = VK_FORMAT_R32G32B32_SFLOAT;
+    attributes[2].format = VK_FORMAT_R8G8B8A8_UNORM;
     attributes[2].offset = offsetof(InstanceData, colorR);
     // Location 3: Scale (per-instance)
     attributes[3].binding = 1;
     attributes[3].location = 3;
-    attributes[3].format = VK_FORMAT_R32_SFLOAT;
+    attributes[3].format = VK_FORMAT_R16_UNORM;
     attributes[3].offset = offsetof(InstanceData, scale);
+    // Location 4: Offset at the previous tick (per-instance)
+    attributes[4].binding = 1;
+    attributes[4].location = 4;
+    attributes[4].format = VK_FORMAT_R16G16_SNORM;
+    attributes[4].offset = offsetof(InstanceData, prevX);
+    // Location 5: Instance type (per-instance)
+    attributes[5].binding = 1;
+    attributes[5].location = 5;
+    attributes[5].format = VK_FORMAT_R16_UINT;
+    attributes[5].offset = offsetof(InstanceData, type);
 
     VkPipelineVertexInputStateCreateInfo vertexInput{};
     vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -802,12 +812,16 @@ bool Renderer::createVertexBuffer() {
     return true;
 }
 
-bool Renderer::createInstanceBuffer(size_t capacity) {
-    m_instanceBufferCapacity = capacity * sizeof(InstanceData);
+// One buffer and one allocation for every slot; drawFrame() binds a slot's
+// region by offset. Host-coherent, so writes through the mapping need no
+// flush before a submit.
+bool Renderer::createInstanceBuffer(uint32_t capacity) {
+    m_instanceCapacity = capacity;
+    VkDeviceSize bufferSize = (VkDeviceSize)INSTANCE_SLOTS * capacity * sizeof(InstanceData);
 
     VkBufferCreateInfo bufferInfo{};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    bufferInfo.size = m_instanceBufferCapacity;
+    bufferInfo.size = bufferSize;
     bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
     bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
@@ -825,8 +839,112 @@ bool Renderer::createInstanceBuffer(size_t capacity) {
     if (vkAllocateMemory(m_device, &allocInfo, nullptr, &m_instanceBufferMemory) != VK_SUCCESS) return false;
     vkBindBufferMemory(m_device, m_instanceBuffer, m_instanceBufferMemory, 0);
 
-    LOG("Instance buffer created for " << capacity << " instances");
+    void* data;
+    if (vkMapMemory(m_device, m_instanceBufferMemory, 0, bufferSize, 0, &data) != VK_SUCCESS) return false;
+    m_instanceMapped = static_cast<InstanceData*>(data);
+
+    LOG("Instance buffer created with " << INSTANCE_SLOTS << " regions of " << capacity << " instances");
     return true;
 }
 
+bool Renderer::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                            VkBuffer& buffer, VkDeviceMemory& memory) {
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(m_device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) return false;
+
+    VkMemoryRequirements memReqs;
+    vkGetBufferMemoryRequirements(m_device, buffer, &memReqs);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memReqs.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memReqs.memoryTypeBits, properties);
+
+    if (vkAllocateMemory(m_device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+        vkDestroyBuffer(m_device, buffer, nullptr);
+        buffer = VK_NULL_HANDLE;
+        return false;
+    }
+    vkBindBufferMemory(m_device, buffer, memory, 0);
+    return true;
+}
+
+void Renderer::destroyStaticInstanceBuffer() {
+    if (m_staticInstanceBuffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(m_device, m_staticInstanceBuffer, nullptr);
+        vkFreeMemory(m_device, m_staticInstanceMemory, nullptr);
+    }
+    m_staticInstanceBuffer = VK_NULL_HANDLE;
+    m_staticInstanceMemory = VK_NULL_HANDLE;
+    m_staticInstanceCount = 0;
+}
+
+// Goes through a staging buffer, since device-local memory need not be
+// host-visible. Rare enough to simply wait for the GPU around it.
+bool Renderer::uploadStaticInstances(std::span<const InstanceData> instances) {
+    if (!m_initialized) return false;
+
+    vkDeviceWaitIdle(m_device);
+    destroyStaticInstanceBuffer();
+    if (instances.empty()) return true;
+
+    VkDeviceSize bufferSize = instances.size_bytes();
+
+    VkBuffer staging;
+    VkDeviceMemory stagingMemory;
+    if (!createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging, stagingMemory)) {
+        return false;
+    }
+
+    void* data;
+    vkMapMemory(m_device, stagingMemory, 0, bufferSize, 0, &data);
+    memcpy(data, instances.data(), bufferSize);
+    vkUnmapMemory(m_device, stagingMemory);
+
+    bool created = createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_staticInstanceBuffer, m_staticInstanceMemory);
+
+    if (created) {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = m_commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer cmd;
+        vkAllocateCommandBuffers(m_device, &allocInfo, &cmd);
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(cmd, &beginInfo);
+
+        VkBufferCopy region{};
+        region.size = bufferSize;
+        vkCmdCopyBuffer(cmd, staging, m_staticInstanceBuffer, 1, &region);
+        vkEndCommandBuffer(cmd);
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &cmd;
+        vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+        vkQueueWaitIdle(m_graphicsQueue);
+
+        vkFreeCommandBuffers(m_device, m_commandPool, 1, &cmd);
+        m_staticInstanceCount = (uint32_t)instances.size();
+        LOG("Static instance buffer uploaded with " << m_staticInstanceCount << " instances");
+    }
+
+    vkDestroyBuffer(m_device, staging, nullptr);
+    vkFreeMemory(m_device, stagingMemory, nullptr);
+    return created;
+}
+
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #define NOMINMAX
 #include <windows.h>
 #include <vulkan/vulkan.h>
+#include <span>
 #include <vector>
 #include <string>
 #include <optional>
@@ -12,26 +13,59 @@ namespace Legionfall {
 
 struct InstanceData;
 
-// Push constants for view transformation
+// Push constants for view transformation and enemy colouring, laid out
+// as the shader's block (vec2 members on 8-byte boundaries)
 struct PushConstants {
     float viewScaleX, viewScaleY;
     float viewOffsetX, viewOffsetY;
+    float heroX, heroY;
+    float interpolation;
+    float time;
 };
 
 class Renderer {
 public:
+    static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+    
+    // Regions of the instance buffer: one per frame in flight, one being
+    // written and one published but not yet picked up
+    static constexpr uint32_t INSTANCE_SLOTS = MAX_FRAMES_IN_FLIGHT + 2;
+    
     Renderer();
     ~Renderer();
     
-    bool init(HWND hwnd, HINSTANCE hinstance, uint32_t width, uint32_t height);
+    bool init(HWND hwnd, HINSTANCE hinstance, uint32_t width, uint32_t height, uint32_t maxInstances);
     void cleanup();
     void onResize(uint32_t width, uint32_t height);
-    void updateInstanceBuffer(const std::vector<InstanceData>& instances);
+    
+    // Persistently mapped memory of an instance slot, maxInstances long. The
+    // CPU may write a slot only while no frame in flight draws from it.
+    InstanceData* instanceSlot(uint32_t slot) const { return m_instanceMapped + (size_t)slot * m_instanceCapacity; }
+    
+    // Waits until the GPU has finished the last frame recorded with this
+    // frame's resources, so every frame before the previous one is done
+    void beginFrame();
+    
+    // Draws count instances from the given slot in the next drawFrame
+    void setInstances(uint32_t slot, uint32_t count) { m_instanceSlot = slot; m_instanceCount = count; }
+    
+    // Copies instances that never move into device-local memory, replacing
+    // any earlier upload. Each frame draws them first, in a draw of their own.
+    bool uploadStaticInstances(std::span<const InstanceData> instances);
     bool drawFrame();
     bool isInitialized() const { return m_initialized; }
     
     // Set camera position (for following hero)
     void setCameraPosition(float x, float y) { m_cameraX = x; m_cameraY = y; }
+    
+    // How far between the previous and current simulation tick to draw instances
+    void setInterpolation(float alpha) { m_interpolation = alpha; }
+    
+    // Hero position at the same interpolation; enemies are coloured by their distance to it
+    void setHeroPosition(float x, float y) { m_heroX = x; m_heroY = y; }
+    
+    // Game time at the same interpolation, for animating static instances
+    void setTime(float seconds) { m_time = seconds; }
 
 private:
     bool createInstance();
@@ -47,7 +81,10 @@ private:
     bool createCommandBuffers();
     bool createSyncObjects();
     bool createVertexBuffer();
-    bool createInstanceBuffer(size_t capacity);
+    bool createInstanceBuffer(uint32_t capacity);
+    bool createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                      VkBuffer& buffer, VkDeviceMemory& memory);
+    void destroyStaticInstanceBuffer();
 
     void cleanupSwapchain();
     bool recreateSwapchain();
@@ -84,6 +121,9 @@ private:
     // Camera
     float m_cameraX = 0.0f, m_cameraY = 0.0f;
     float m_viewHalfWidth = 12.0f;  // Orthographic view half-width
+    float m_interpolation = 1.0f;
+    float m_heroX = 0.0f, m_heroY = 0.0f;
+    float m_time = 0.0f;
 
     // Core Vulkan
     VkInstance m_instance = VK_NULL_HANDLE;
@@ -112,7 +152,6 @@ private:
     std::vector<VkCommandBuffer> m_commandBuffers;
 
     // Sync
-    static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
     std::vector<VkSemaphore> m_imageAvailableSemaphores;
     std::vector<VkSemaphore> m_renderFinishedSemaphores;
     std::vector<VkFence> m_inFlightFences;
@@ -123,11 +162,19 @@ private:
     VkDeviceMemory m_vertexBufferMemory = VK_NULL_HANDLE;
     uint32_t m_vertexCount = 0;
 
-    // Instance buffer (per-instance data)
+    // Instance buffer (per-instance data): INSTANCE_SLOTS regions of
+    // m_instanceCapacity instances, mapped for its whole lifetime
     VkBuffer m_instanceBuffer = VK_NULL_HANDLE;
     VkDeviceMemory m_instanceBufferMemory = VK_NULL_HANDLE;
-    size_t m_instanceBufferCapacity = 0;
+    InstanceData* m_instanceMapped = nullptr;
+    uint32_t m_instanceCapacity = 0;
+    uint32_t m_instanceSlot = 0;
     uint32_t m_instanceCount = 0;
+
+    // Static instance buffer, device-local and written once per upload
+    VkBuffer m_staticInstanceBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory m_staticInstanceMemory = VK_NULL_HANDLE;
+    uint32_t m_staticInstanceCount = 0;
 };
 
 }
\ No newline at end of file
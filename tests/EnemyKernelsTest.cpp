@@ -0,0 +1,148 @@
+#include "core/EnemyKernels.h"
+#include "core/FlowField.h"
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+using namespace Legionfall;
+
+namespace {
+    constexpr size_t BLOCKS = 4;
+    constexpr size_t COUNT = BLOCKS * 64;
+    constexpr int MOVE_PASSES = 20000;
+    
+    // EnemyKernels.h promises this per step for the first 100 s of game time
+    constexpr float SCALAR_TOLERANCE = 1e-5f;
+    
+    struct Enemies {
+        alignas(64) float x[COUNT];
+        alignas(64) float y[COUNT];
+        alignas(64) float phase[COUNT];
+        alignas(64) float chaseSpeed[COUNT];
+        alignas(64) float baseX[COUNT];
+        alignas(64) float baseY[COUNT];
+        alignas(64) float speed[COUNT];
+        uint64_t alive[BLOCKS];
+        
+        void reset() {
+            for (size_t i = 0; i < COUNT; ++i) {
+                x[i] = -40.0f + (float)(i % 37) * 2.0f;
+                y[i] = 30.0f - (float)(i % 23) * 3.0f;
+                phase[i] = (float)i * 0.37f;
+                chaseSpeed[i] = 2.0f + (float)(i % 5);
+                baseX[i] = x[i];
+                baseY[i] = y[i];
+                speed[i] = 1.0f + (float)(i % 3);
+            }
+            // Every 4-, 8- and 16-lane group of the first blocks is partly
+            // dead; the last block is fully alive so the unmasked path runs too
+            alive[0] = 0xAAAAAAAAAAAAAAAAull;
+            alive[1] = 0x1248124812481248ull;
+            alive[2] = 0x7777777777777777ull;
+            alive[3] = ~0ull;
+        }
+        
+        bool isAlive(size_t i) const { return (alive[i / 64] >> (i % 64)) & 1; }
+        
+        EnemyMoveBatch batch() {
+            return {x, y, phase, chaseSpeed, baseX, baseY, speed, alive, 0, BLOCKS};
+        }
+    };
+    
+    EnemyMoveParams makeParams(bool chaseMode, const FlowField* flow) {
+        EnemyMoveParams params{3.0f, -2.0f, 1.25f, 1.0f / 60.0f, 50.0f, chaseMode, {}};
+        if (flow) params.flow = flow->view();
+        return params;
+    }
+    
+    // The game's field, with a wall so plenty of cells steer off the
+    // straight line to the hero
+    void buildFlowField(FlowField& flow) {
+        flow.configure(-50.0f, -50.0f, 50.0f, 50.0f, 0.5f);
+        for (uint32_t cy = 40; cy < 160; ++cy) {
+            flow.setBlocked(80, cy, true);
+        }
+        flow.update(3.0f, -2.0f, nullptr);
+    }
+    
+    Enemies scalarEnemies, simdEnemies;
+    
+    // One step of a SIMD kernel must match the scalar kernel on live lanes
+    bool matchesScalar(SimdLevel level, bool chaseMode, const FlowField* flow) {
+        scalarEnemies.reset();
+        simdEnemies.reset();
+        EnemyMoveBatch scalarBatch = scalarEnemies.batch();
+        EnemyMoveBatch simdBatch = simdEnemies.batch();
+        moveEnemiesScalar(scalarBatch, makeParams(chaseMode, flow));
+        enemyMoveKernel(level)(simdBatch, makeParams(chaseMode, flow));
+        
+        for (size_t i = 0; i < COUNT; ++i) {
+            if (std::fabs(scalarEnemies.x[i] - simdEnemies.x[i]) > SCALAR_TOLERANCE ||
+                std::fabs(scalarEnemies.y[i] - simdEnemies.y[i]) > SCALAR_TOLERANCE) {
+                std::printf("FAIL: %s %s%s enemy %zu is (%.7f, %.7f), scalar kernel gives (%.7f, %.7f)\n",
+                    simdLevelName(level), chaseMode ? "chasing" : "wandering", flow ? " with flow field" : "", i,
+                    simdEnemies.x[i], simdEnemies.y[i], scalarEnemies.x[i], scalarEnemies.y[i]);
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    // Respawn writes the positions of dead enemies while the move pass runs.
+    // A second thread keeps overwriting the dead slots and reads each write
+    // back; any change it didn't make came from the kernel.
+    bool leavesDeadSlotsAlone(SimdLevel level, const FlowField* flow) {
+        simdEnemies.reset();
+        EnemyMoveBatch batch = simdEnemies.batch();
+        EnemyMoveParams params = makeParams(true, flow);
+        EnemyMoveKernel kernel = enemyMoveKernel(level);
+        
+        std::atomic<bool> done{false};
+        std::atomic<size_t> clobbered{0};
+        std::thread respawner([&] {
+            volatile float* x = simdEnemies.x;
+            volatile float* y = simdEnemies.y;
+            for (float generation = 0.0f; !done.load(std::memory_order_relaxed); generation += 1.0f) {
+                float value = -1000.0f - std::fmod(generation, 1000.0f);
+                for (size_t i = 0; i < COUNT; ++i) {
+                    if (simdEnemies.isAlive(i)) continue;
+                    x[i] = value;
+                    y[i] = value;
+                }
+                for (size_t i = 0; i < COUNT; ++i) {
+                    if (simdEnemies.isAlive(i)) continue;
+                    if (x[i] != value || y[i] != value) clobbered.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+        
+        for (int pass = 0; pass < MOVE_PASSES; ++pass) {
+            kernel(batch, params);
+        }
+        done.store(true, std::memory_order_relaxed);
+        respawner.join();
+        
+        if (clobbered.load() != 0) {
+            std::printf("FAIL: %s kernel overwrote dead enemies %zu times\n", simdLevelName(level), clobbered.load());
+            return false;
+        }
+        return true;
+    }
+}
+
+int main() {
+    FlowField flow;
+    buildFlowField(flow);
+    
+    // Every kernel this CPU can run; none at all where there is no SIMD kernel
+    bool ok = true;
+    for (int l = (int)SimdLevel::SSE2; l <= (int)detectSimdLevel(); ++l) {
+        SimdLevel level = (SimdLevel)l;
+        ok = matchesScalar(level, true, nullptr) && matchesScalar(level, false, nullptr) &&
+             matchesScalar(level, true, &flow) && leavesDeadSlotsAlone(level, &flow) && ok;
+        std::printf("%s kernel checked\n", simdLevelName(level));
+    }
+    std::printf("%s\n", ok ? "EnemyKernelsTest passed" : "EnemyKernelsTest failed");
+    return ok ? 0 : 1;
+}
\ No newline at end of file
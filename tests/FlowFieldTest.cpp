@@ -0,0 +1,112 @@
+#include "core/FlowField.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+using namespace Legionfall;
+
+namespace {
+    // The game's arena and cell size
+    constexpr float ARENA_HALF = 10.0f;
+    constexpr float CELL_SIZE = 0.5f;
+    constexpr float STEP = 0.05f;
+    constexpr int MAX_STEPS = 4000;
+    
+    // A wall down the middle of the arena, open only below WALL_END
+    constexpr uint32_t WALL_COLUMN = 20;
+    constexpr float WALL_END = -7.0f;
+    
+    uint32_t cellOf(float v) {
+        return (uint32_t)std::floor((v + ARENA_HALF) / CELL_SIZE);
+    }
+    
+    // Walks from (x, y) to the target the way a chasing enemy does: along the
+    // field where it has a direction, straight at the target where it hasn't.
+    // Fails if the walker enters a blocked cell or never arrives.
+    bool walkAroundWall(const FlowField& field, float x, float y, float targetX, float targetY) {
+        FlowFieldView view = field.view();
+        float lowestY = y;
+        
+        for (int step = 0; step < MAX_STEPS; ++step) {
+            float toX = targetX - x, toY = targetY - y;
+            float distance = std::sqrt(toX * toX + toY * toY);
+            if (distance < CELL_SIZE) {
+                if (lowestY > WALL_END) {
+                    std::printf("FAIL: walker reached the target without going round the wall (lowest y %.2f)\n", lowestY);
+                    return false;
+                }
+                return true;
+            }
+            
+            uint32_t cx = cellOf(x), cy = cellOf(y);
+            if (field.isBlocked(cx, cy)) {
+                std::printf("FAIL: walker entered blocked cell (%u, %u) at step %d\n", cx, cy, step);
+                return false;
+            }
+            
+            size_t cell = (size_t)cy * view.cellsX + cx;
+            float dx = view.dirX[cell], dy = view.dirY[cell];
+            if (dx == 0.0f && dy == 0.0f) {
+                dx = toX / distance;
+                dy = toY / distance;
+            }
+            x += dx * STEP;
+            y += dy * STEP;
+            lowestY = std::min(lowestY, y);
+        }
+        
+        std::printf("FAIL: walker still (%.2f, %.2f) from the target after %d steps\n", targetX - x, targetY - y, MAX_STEPS);
+        return false;
+    }
+    
+    // With no obstacles every direction should point close to straight at the target
+    bool pointsAtTargetInOpenSpace(FlowField& field, float targetX, float targetY) {
+        field.clearObstacles();
+        field.update(targetX, targetY, nullptr);
+        FlowFieldView view = field.view();
+        
+        float worst = 0.0f;
+        for (uint32_t cy = 0; cy < view.cellsY; ++cy) {
+            for (uint32_t cx = 0; cx < view.cellsX; ++cx) {
+                size_t cell = (size_t)cy * view.cellsX + cx;
+                float dx = view.dirX[cell], dy = view.dirY[cell];
+                if (dx == 0.0f && dy == 0.0f) continue;
+                
+                float toX = targetX - (-ARENA_HALF + (cx + 0.5f) * CELL_SIZE);
+                float toY = targetY - (-ARENA_HALF + (cy + 0.5f) * CELL_SIZE);
+                float cosine = (dx * toX + dy * toY) / std::sqrt(toX * toX + toY * toY);
+                worst = std::max(worst, std::acos(std::min(1.0f, cosine)) * 57.2958f);
+            }
+        }
+        if (worst > 10.0f) {
+            std::printf("FAIL: open-space direction off by %.1f degrees\n", worst);
+            return false;
+        }
+        return true;
+    }
+}
+
+int main() {
+    FlowField field;
+    field.configure(-ARENA_HALF, -ARENA_HALF, ARENA_HALF, ARENA_HALF, CELL_SIZE);
+    bool ok = pointsAtTargetInOpenSpace(field, 3.3f, -1.8f);
+    
+    for (uint32_t cy = cellOf(WALL_END); cy < field.cellsY(); ++cy) {
+        field.setBlocked(WALL_COLUMN, cy, true);
+    }
+    field.update(6.0f, 5.0f, nullptr);
+    ok = walkAroundWall(field, -6.0f, 5.0f, 6.0f, 5.0f) && ok;
+    
+    // Moving the target within its cell doesn't rebuild; crossing to the
+    // other side of the wall does, and the walk reverses
+    bool rebuilt = field.update(6.1f, 5.1f, nullptr);
+    if (rebuilt) {
+        std::printf("FAIL: field rebuilt although the target stayed in its cell\n");
+        ok = false;
+    }
+    field.update(-6.0f, 5.0f, nullptr);
+    ok = walkAroundWall(field, 6.0f, 5.0f, -6.0f, 5.0f) && ok;
+    
+    std::printf("%s\n", ok ? "FlowFieldTest passed" : "FlowFieldTest failed");
+    return ok ? 0 : 1;
+}
\ No newline at end of file